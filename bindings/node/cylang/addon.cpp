@@ -32,18 +32,19 @@ namespace cylang {
 class Binding {
   public:
     static napi_value Compile(napi_env env, napi_callback_info info) {
-        napi_value argv[3];
-        size_t argc = 3;
+        napi_value argv[5];
+        size_t argc = 5;
         napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
-        if (argc != 3) {
+        if (argc != 5) {
             napi_throw_error(env, "EINVAL", "Missing one or more arguments");
             return NULL;
         }
 
         CYPool pool;
 
-        std::string code;
-        if (!GetStringArg(env, argv[0], code))
+        char *code;
+        size_t size;
+        if (!GetStringArg(env, pool, argv[0], code, size))
             return NULL;
 
         bool strict;
@@ -54,14 +55,24 @@ class Binding {
         if (!GetBoolArg(env, argv[2], pretty))
             return NULL;
 
-        std::stringbuf stream(code);
-        CYDriver driver(pool, stream);
+        CYOptions options;
+
+        uint32_t level;
+        if (napi_get_value_uint32(env, argv[3], &level) != napi_ok || level > 1) {
+            napi_throw_type_error(env, "EINVAL", "Expected an optimization level of 0 or 1");
+            return NULL;
+        }
+        options.Level(level);
+
+        if (!GetPassesArg(env, pool, argv[4], options))
+            return NULL;
+
+        CYDriver driver(pool, code, size);
         driver.strict_ = strict;
 
         if (driver.Parse() || !driver.errors_.empty()) {
             for (CYDriver::Errors::const_iterator error(driver.errors_.begin()); error != driver.errors_.end(); ++error) {
-                auto message(error->message_);
-                napi_throw_error(env, "EINVAL", message.c_str());
+                napi_throw_error(env, "EINVAL", error->message_);
                 return NULL;
             }
 
@@ -75,7 +86,6 @@ class Binding {
         }
 
         std::stringbuf str;
-        CYOptions options;
         CYOutput out(str, options);
         out.pretty_ = pretty;
         driver.Replace(options);
@@ -88,15 +98,51 @@ class Binding {
     }
 
   private:
-    static bool GetStringArg(napi_env env, napi_value value, std::string &result) {
-        size_t size;
+    // leaves the two trailing NUL bytes the driver needs to scan the string in place
+    static bool GetStringArg(napi_env env, CYPool &pool, napi_value value, char *&result, size_t &size) {
         if (napi_get_value_string_utf8(env, value, NULL, 0, &size) != napi_ok) {
             napi_throw_type_error(env, "EINVAL", "Expected a string");
             return false;
         }
-        result.resize(size, '\0');
+        result = pool.malloc<char>(size + 2, 1);
+
+        napi_get_value_string_utf8(env, value, result, size + 1, &size);
+        result[size] = '\0';
+        result[size + 1] = '\0';
 
-        napi_get_value_string_utf8(env, value, &result[0], size + 1, &size);
+        return true;
+    }
+
+    // each pass is an object key, turned on or off by its value
+    static bool GetPassesArg(napi_env env, CYPool &pool, napi_value value, CYOptions &options) {
+        napi_value names;
+        uint32_t count;
+        if (napi_get_property_names(env, value, &names) != napi_ok || napi_get_array_length(env, names, &count) != napi_ok) {
+            napi_throw_type_error(env, "EINVAL", "Expected an object of passes");
+            return false;
+        }
+
+        for (uint32_t i(0); i != count; ++i) {
+            napi_value name;
+            napi_get_element(env, names, i, &name);
+
+            char *pass;
+            size_t size;
+            if (!GetStringArg(env, pool, name, pass, size))
+                return false;
+
+            napi_value enable;
+            napi_get_property(env, value, name, &enable);
+
+            bool result;
+            if (!GetBoolArg(env, enable, result))
+                return false;
+
+            if (!options.Enable(pass, result)) {
+                napi_throw_error(env, "EINVAL", "Unknown optimization pass");
+                return false;
+            }
+        }
 
         return true;
     }
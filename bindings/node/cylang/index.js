@@ -9,6 +9,8 @@ function compile(source, options) {
 
   const strict = ('strict' in options) ? options.strict : false;
   const pretty = ('pretty' in options) ? options.pretty : false;
+  const optimize = ('optimize' in options) ? options.optimize : 1;
+  const passes = ('passes' in options) ? options.passes : {};
 
-  return binding.compile(source, strict, pretty);
+  return binding.compile(source, strict, pretty, optimize, passes);
 }
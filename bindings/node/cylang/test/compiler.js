@@ -26,4 +26,50 @@ describe('Compiler', function () {
     const prettyOutput = cylang.compile(code, { pretty: true });
     prettyOutput.should.not.equal(compactOutput);
   });
+
+  it('should support optimization levels and passes', function () {
+    const code = '(function (name) { var value = name; return value; })';
+    cylang.compile(code).should.not.match(/value/);
+    cylang.compile(code, { optimize: 0 }).should.match(/value/);
+    (function () {
+      cylang.compile(code, { optimize: 2 })
+    }).should.throw(/^Expected an optimization level/);
+    cylang.compile(code, { passes: { rename: false } }).should.match(/value/);
+    (function () {
+      cylang.compile(code, { passes: { unknown: true } })
+    }).should.throw(/^Unknown optimization pass/);
+  });
+
+  it('should fold constant expressions', function () {
+    cylang.compile('x = (1 << 4 | 3) + `${0x10}px`').should.equal('x="1916px"');
+    cylang.compile('x = 2 - 5 < y').should.equal('x=-3<y');
+    cylang.compile('x = 1 << 4', { passes: { fold: false } }).should.equal('x=1<<4');
+    cylang.compile('`use ${"strict"}`; x').should.match(/^\("use strict"\)/);
+  });
+
+  it('should eliminate dead code', function () {
+    const code = '(function () { if (false) { var x = 1; } return 2; g(); })';
+    cylang.compile(code).should.not.match(/var|g\(\)/);
+    cylang.compile(code, { passes: { eliminate: false } }).should.match(/var[^]*g\(\)/);
+    cylang.compile('(true ? o.m : 0)()').should.equal('(0,o.m)()');
+  });
+
+  it('should lower templates and comprehensions without calls', function () {
+    const code = '(function (a) { var b = [for (x of a) x * 2]; return `<${b}>`; })';
+    const output = cylang.compile(code);
+    output.match(/function/g).should.have.length(1);
+    output.should.not.match(/concat/);
+    cylang.compile(code, { passes: { inline: false } }).should.match(/concat\.apply/);
+    const single = '(function (a, c) { if (c) return [for (x of a) x]; while (c) c = [for (x of a) x]; do c = [for (x of a) x]; while (c); })';
+    cylang.compile(single).match(/function/g).should.have.length(1);
+    const evaluated = '(function (a, y, s) { var b = [for (y of a) eval(s)]; return y; })';
+    cylang.compile(evaluated).match(/function/g).should.have.length(2);
+  });
+
+  it('should unwind returns from blocks', function () {
+    const code = '(function (a) { a.each { |x| if (x) return x; }; return 0; })';
+    cylang.compile(code).should.match(/try[^]*throw/);
+    cylang.compile('(function (a) { a.each { |x| return function () { return x; }; }; })').match(/throw/g).should.have.length(2);
+    cylang.compile('(function (a) { a.each { |x| x }; })').should.not.match(/try/);
+  });
 });
@@ -0,0 +1,130 @@
+/* Cycript - The Truly Universal Scripting Language
+ * Copyright (C) 2009-2016  Jay Freeman (saurik)
+*/
+
+/* GNU Affero General Public License, Version 3 {{{ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/* }}} */
+
+#ifndef CYCRIPT_ATOM_HPP
+#define CYCRIPT_ATOM_HPP
+
+#include <cstring>
+
+#include <stdint.h>
+
+#include "Pooling.hpp"
+
+// interned spellings: equal words share one pointer, so callers can compare atoms with ==
+class CYAtoms {
+  private:
+    struct Slot {
+        const char *word_;
+        uint32_t hash_;
+    };
+
+    CYPool *pool_;
+    Slot *slots_;
+    size_t mask_;
+    size_t count_;
+
+    static uint32_t Hash(const char *data, size_t size) {
+        uint32_t hash(2166136261u);
+        for (size_t i(0); i != size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    Slot *Probe(const char *data, size_t size, uint32_t hash) const {
+        for (size_t index(hash & mask_); ; index = (index + 1) & mask_) {
+            Slot &slot(slots_[index]);
+            if (slot.word_ == NULL || slot.word_ == data)
+                return &slot;
+            if (slot.hash_ == hash && memcmp(slot.word_, data, size) == 0 && slot.word_[size] == '\0')
+                return &slot;
+        }
+    }
+
+    void Grow() {
+        size_t size(slots_ == NULL ? 64 : (mask_ + 1) * 2);
+        Slot *slots(slots_);
+        size_t mask(mask_);
+
+        slots_ = pool_->calloc<Slot>(size, sizeof(Slot));
+        mask_ = size - 1;
+
+        if (slots != NULL)
+            for (size_t index(0); index != mask + 1; ++index)
+                if (slots[index].word_ != NULL) {
+                    size_t probe(slots[index].hash_ & mask_);
+                    while (slots_[probe].word_ != NULL)
+                        probe = (probe + 1) & mask_;
+                    slots_[probe] = slots[index];
+                }
+    }
+
+    const char *Intern(const char *data, size_t size, bool copy) {
+        if ((count_ + 1) * 4 > (mask_ + 1) * 3 || slots_ == NULL)
+            Grow();
+
+        uint32_t hash(Hash(data, size));
+        Slot *slot(Probe(data, size, hash));
+        if (slot->word_ != NULL)
+            return slot->word_;
+
+        slot->word_ = copy ? pool_->strmemdup(data, size) : data;
+        slot->hash_ = hash;
+        ++count_;
+        return slot->word_;
+    }
+
+  public:
+    CYAtoms(CYPool &pool) :
+        pool_(&pool),
+        slots_(NULL),
+        mask_(0),
+        count_(0)
+    {
+    }
+
+    // forgets every atom; the table is allocated again from the new pool
+    void Reset(CYPool &pool) {
+        pool_ = &pool;
+        slots_ = NULL;
+        mask_ = 0;
+        count_ = 0;
+    }
+
+    const char *Intern(const char *data, size_t size) {
+        return Intern(data, size, true);
+    }
+
+    // the word must outlive the table; it becomes the atom if it is new
+    const char *Intern(const char *word) {
+        return Intern(word, strlen(word), false);
+    }
+
+    const char *Find(const char *word) const {
+        if (slots_ == NULL)
+            return NULL;
+        size_t size(strlen(word));
+        return Probe(word, size, Hash(word, size))->word_;
+    }
+};
+
+#endif/*CYCRIPT_ATOM_HPP*/
@@ -24,7 +24,11 @@
 
 #include <iostream>
 
+#include "Driver.hpp"
+#include "Options.hpp"
+#include "Pooling.hpp"
 #include "String.hpp"
+#include "Syntax.hpp"
 
 class CYStream :
     public std::streambuf
@@ -35,7 +39,40 @@ class CYStream :
     }
 };
 
+// lowers and prints each top-level statement as soon as the driver has parsed it
+// the nodes and the driver's atoms live in two pools that take turns, so memory does not grow with the script
+class _visible CYCompiler :
+    public CYConsumer
+{
+  private:
+    CYDriver &driver_;
+    CYPool *base_;
+
+    CYPool pools_[2];
+    CYPool::Mark empty_;
+    unsigned current_;
+
+    unsigned unique_;
+    size_t carried_;
+
+    void Carry();
+
+  public:
+    CYOptions &options_;
+    CYOutput out_;
+
+    CYCompiler(CYDriver &driver, std::streambuf &out, CYOptions &options);
+    ~CYCompiler();
+
+    virtual void Consume(CYDriver &driver, const CYLocation &location, CYStatement *statements);
+};
+
+// when streaming, each statement is lowered as soon as it is parsed, so the tree is never held whole
+// the output can then differ textually, as hoisted declarations are emitted per statement
+CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream, CYOptions &options, bool streaming);
+CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream, CYOptions &options);
 CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream);
+CYUTF8String CYPoolCode(CYPool &pool, CYUTF8String code, CYOptions &options);
 CYUTF8String CYPoolCode(CYPool &pool, CYUTF8String code);
 
 #endif//CODE_HPP
@@ -26,11 +26,17 @@
 #include "Driver.hpp"
 #include "Replace.hpp"
 #include "String.hpp"
+#include "Value.hpp"
 
 static CYExpression *ParseExpression(CYPool &pool, CYUTF8String code) {
-    std::stringstream stream;
-    stream << '(' << code << ')';
-    CYDriver driver(pool, *stream.rdbuf());
+    size_t size(code.size + 2);
+    char *data(pool.malloc<char>(size + 2, 1));
+    data[0] = '(';
+    memcpy(data + 1, code.data, code.size);
+    data[size - 1] = ')';
+    data[size] = '\0';
+    data[size + 1] = '\0';
+    CYDriver driver(pool, data, size);
     if (driver.Parse() || !driver.errors_.empty())
         return NULL;
 
@@ -53,8 +59,7 @@ static CYExpression *ParseExpression(CYPool &pool, CYUTF8String code) {
 _visible char **CYComplete(const char *word, const std::string &line, CYUTF8String (*run)(CYPool &pool, const std::string &)) {
     CYLocalPool pool;
 
-    std::stringbuf stream(line);
-    CYDriver driver(pool, stream);
+    CYDriver driver(pool, CYUTF8String(line.c_str(), line.size()));
 
     driver.auto_ = true;
 
@@ -153,7 +158,9 @@ _visible char **CYComplete(const char *word, const std::string &line, CYUTF8Stri
     CYUTF8String json(run(pool, code));
     // XXX: if this fails we should not try to parse it
 
-    CYExpression *result(ParseExpression(pool, json));
+    CYExpression *result(CYParseValue(pool, json));
+    if (result == NULL)
+        result = ParseExpression(pool, json);
     if (result == NULL)
         return NULL;
 
@@ -25,11 +25,15 @@
 #include "JavaScript.hpp"
 #endif
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdio>
 #include <complex>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #ifdef HAVE_READLINE_H
 #include <readline.h>
@@ -74,6 +78,7 @@
 #include "Error.hpp"
 #include "Highlight.hpp"
 #include "Syntax.hpp"
+#include "Value.hpp"
 
 extern "C" int rl_display_fixed;
 extern "C" int _rl_vis_botlin;
@@ -234,14 +239,15 @@ static void sigint(int) {
 
 static bool bison_;
 static bool timing_;
+static bool pool_;
 static bool strict_;
 static bool pretty_;
+// -c then writes each statement out as soon as it is parsed, instead of the whole script once it parsed
+static bool stream_;
 
 void Setup(CYDriver &driver) {
-    if (bison_)
-        driver.debug_ = 1;
-    if (strict_)
-        driver.strict_ = true;
+    driver.debug_ = bison_ ? 1 : 0;
+    driver.strict_ = strict_;
 }
 
 void Setup(CYOutput &out, CYDriver &driver, CYOptions &options, bool lower) {
@@ -279,15 +285,19 @@ static void Output(CYUTF8String json, std::ostream *out, bool reparse = false) {
     CYPool pool;
 
     if (reparse) do {
-        CYStream stream(json.data, json.data + json.size);
-        CYDriver driver(pool, stream);
-        if (driver.Parse(CYMarkExpression))
-            break;
+        CYExpression *value(CYParseValue(pool, json));
+        if (value == NULL) {
+            CYDriver driver(pool, json);
+            if (driver.Parse(CYMarkExpression))
+                break;
+            value = driver.context_;
+        }
+
         std::stringbuf str;
         CYOptions options;
         CYOutput out(str, options);
         out.pretty_ = true;
-        out << *driver.context_;
+        out << *value;
         std::string data(str.str());
         json = CYPoolUTF8String(pool, data);
         if (json.size == 0)
@@ -382,6 +392,52 @@ static void _lblcall(int (*command)(int, int), int count, int key) {
     _rl_last_c_pos = last;
 }
 
+// top-level statements that were followed by another one can no longer change as lines are added
+class CYConsoleStable :
+    public CYConsumer
+{
+  public:
+    unsigned count_;
+    CYPosition last_;
+    CYPosition stable_;
+
+    CYConsoleStable() :
+        count_(0)
+    {
+    }
+
+    virtual void Consume(CYDriver &driver, const CYLocation &location, CYStatement *statements) {
+        if (count_++ != 0)
+            stable_ = last_;
+        last_ = location.end;
+    }
+};
+
+// the start of the buffer that is already known to be a series of complete statements
+static std::string stable_;
+static size_t stable_lines_;
+
+static size_t CYConsoleOffset(const std::string &command, size_t start, const CYPosition &position) {
+    size_t offset(start);
+    for (unsigned line(1); line != position.line; ++line) {
+        offset = command.find('\n', offset);
+        if (offset == std::string::npos)
+            return offset;
+        ++offset;
+    }
+
+    offset += position.column;
+    if (offset > command.size())
+        return std::string::npos;
+
+    // the scanner also ends lines at \r and U+2028/U+2029, which this does not count
+    for (size_t i(start); i != offset; ++i)
+        if (command[i] == '\r' || (command[i] == '\xe2' && i + 2 < command.size() && command[i + 1] == '\x80' && (command[i + 2] == '\xa8' || command[i + 2] == '\xa9')))
+            return std::string::npos;
+
+    return offset;
+}
+
 static int CYConsoleKeyReturn(int count, int key) {
     if (rl_point != rl_end) {
         if (memchr(rl_line_buffer, '\n', rl_end) == NULL) {
@@ -415,25 +471,46 @@ static int CYConsoleKeyReturn(int count, int key) {
     else {
         std::string command(rl_line_buffer, rl_end);
         command += '\n';
-        std::stringbuf stream(command);
 
         size_t last(std::string::npos);
         for (size_t i(0); i != std::string::npos; i = command.find('\n', i + 1))
             ++last;
 
+        // only the text after the stable prefix is parsed again, so pasting is no longer quadratic
+        size_t skip(0);
+        if (!stable_.empty() && command.compare(0, stable_.size(), stable_) == 0)
+            skip = stable_.size();
+        else {
+            stable_.clear();
+            stable_lines_ = 0;
+        }
+
         CYPool pool;
-        CYDriver driver(pool, stream);
+        CYConsoleStable stable;
+        CYDriver driver(pool, CYUTF8String(command.c_str() + skip, command.size() - skip));
+        driver.consumer_ = &stable;
+
         if (driver.Parse() || !driver.errors_.empty())
             for (CYDriver::Errors::const_iterator error(driver.errors_.begin()); error != driver.errors_.end(); ++error) {
-                if (error->location_.begin.line != last + 1)
+                if (error->location_.begin.line + stable_lines_ != last + 1)
                     done = true;
                 break;
             }
         else
             done = true;
+
+        if (!done && stable.count_ > 1) {
+            size_t offset(CYConsoleOffset(command, skip, stable.stable_));
+            if (offset != std::string::npos) {
+                stable_lines_ += stable.stable_.line - 1;
+                stable_.assign(command, 0, offset);
+            }
+        }
     }
 
     if (done) {
+        stable_.clear();
+        stable_lines_ = 0;
         _lblcall(&rl_newline, count, key);
         return 0;
     }
@@ -632,6 +709,9 @@ static void Console(CYOptions &options) {
 
     CYOutputRun("");
 
+    CYPool pool;
+    CYDriver driver(pool, CYUTF8String(""));
+
     for (;;) {
         struct sigaction action;
         sigemptyset(&action.sa_mask);
@@ -686,6 +766,9 @@ static void Console(CYOptions &options) {
 #endif
             } else if (data == "exit") {
                 return;
+            } else if (data == "pool") {
+                CYPoolSetTracking(true);
+                CYPoolReport(*out_);
             } else if (data == "lower") {
                 lower = !lower;
                 *out_ << "lower == " << (lower ? "true" : "false") << std::endl;
@@ -701,10 +784,8 @@ static void Console(CYOptions &options) {
         if (bypass)
             code = command;
         else try {
-            std::stringbuf stream(command);
-
-            CYPool pool;
-            CYDriver driver(pool, stream);
+            CYPoolCheckpoint checkpoint(pool);
+            driver.Reset(pool, CYUTF8String(command.c_str(), command.size()));
             Setup(driver);
 
             if (driver.Parse() || !driver.errors_.empty()) {
@@ -769,12 +850,170 @@ static uint64_t CYGetTime() {
 #endif
 }
 
+static void CYPassReport(const CYOptions &options) {
+    for (unsigned pass(0); pass != CYPassCount; ++pass)
+        std::cerr << CYPasses_[pass].name_ << '\t' << options.times_[pass] << std::endl;
+}
+
+struct CYBatchFile {
+    std::string path_;
+    std::string code_;
+    std::string errors_;
+    bool failed_;
+    bool done_;
+    uint64_t times_[CYPassCount];
+
+    CYBatchFile(const std::string &path) :
+        path_(path),
+        failed_(false),
+        done_(false),
+        times_()
+    {
+    }
+};
+
+static void CYBatchCompile(CYBatchFile &file, CYOptions &shared) {
+    std::ostringstream errors;
+
+    // each worker collects its own times, which are summed up in order
+    CYOptions options(shared);
+    if (options.times_ != NULL)
+        options.times_ = file.times_;
+
+    try {
+        std::fstream stream(file.path_.c_str(), std::ios::in | std::ios::binary);
+        if (stream.fail()) {
+            errors << file.path_ << ": " << strerror(errno) << std::endl;
+            file.failed_ = true;
+        } else {
+            CYLocalPool pool;
+            CYDriver driver(pool, *stream.rdbuf(), file.path_);
+            Setup(driver);
+
+            std::stringbuf str;
+            if (!stream_)
+                file.failed_ = driver.Parse();
+            else {
+                CYCompiler compiler(driver, str, options);
+                compiler.out_.pretty_ = pretty_;
+                file.failed_ = driver.Parse();
+            }
+
+            if (file.failed_ || !driver.errors_.empty()) {
+                for (CYDriver::Errors::const_iterator i(driver.errors_.begin()); i != driver.errors_.end(); ++i)
+                    errors << i->location_.begin << ": " << i->message_ << std::endl;
+                file.failed_ = true;
+            } else {
+                if (!stream_ && driver.script_ != NULL) {
+                    CYOutput out(str, options);
+                    Setup(out, driver, options, true);
+                    out << *driver.script_;
+                }
+
+                file.code_ = str.str();
+            }
+        }
+    } catch (const CYException &error) {
+        CYPool pool;
+        errors << file.path_ << ": " << error.PoolCString(pool) << std::endl;
+        file.failed_ = true;
+    } catch (const std::exception &error) {
+        errors << file.path_ << ": " << error.what() << std::endl;
+        file.failed_ = true;
+    } catch (...) {
+        errors << file.path_ << ": unknown error" << std::endl;
+        file.failed_ = true;
+    }
+
+    file.errors_ = errors.str();
+}
+
+// compiles every file on its own thread-local pool and driver, printing the results in order
+static int CYBatch(CYOptions &options, unsigned jobs, int argc, char * const argv[]) {
+    std::vector<CYBatchFile> files;
+    for (int i(0); i != argc; ++i)
+        if (argv[i][0] != '@')
+            files.push_back(CYBatchFile(argv[i]));
+        else {
+            // a manifest lists one file per line
+            std::ifstream manifest(argv[i] + 1);
+            if (manifest.fail()) {
+                fprintf(stderr, "%s: %s\n", argv[i] + 1, strerror(errno));
+                return 1;
+            }
+
+            std::string line;
+            while (std::getline(manifest, line))
+                if (!line.empty())
+                    files.push_back(CYBatchFile(line));
+        }
+
+    if (jobs > files.size())
+        jobs = files.size();
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<size_t> next(0);
+
+    std::vector<std::thread> workers;
+    for (unsigned i(0); i != jobs; ++i)
+        workers.push_back(std::thread([&]() {
+            for (size_t index; (index = next++) < files.size(); ) {
+                // nothing may leave the thread, and the file has to be marked done either way
+                try {
+                    CYBatchCompile(files[index], options);
+                } catch (...) {
+                    files[index].failed_ = true;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                files[index].done_ = true;
+                finished.notify_all();
+            }
+        }));
+
+    int status(0);
+
+    for (std::vector<CYBatchFile>::iterator file(files.begin()); file != files.end(); ++file) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!file->done_)
+                finished.wait(lock);
+        }
+
+        std::cerr << file->errors_;
+        if (options.times_ != NULL)
+            for (unsigned pass(0); pass != CYPassCount; ++pass)
+                options.times_[pass] += file->times_[pass];
+        if (file->failed_)
+            status = 1;
+        else
+            std::cout << file->code_;
+
+        std::string().swap(file->code_);
+        std::string().swap(file->errors_);
+    }
+
+    for (std::vector<std::thread>::iterator worker(workers.begin()); worker != workers.end(); ++worker)
+        worker->join();
+
+    if (options.times_ != NULL)
+        CYPassReport(options);
+
+    return status;
+}
+
 int Main(int argc, char * const argv[], char const * const envp[]) {
     bool tty(isatty(STDIN_FILENO));
     bool compile(false);
     bool target(false);
+    unsigned jobs(0);
     CYOptions options;
 
+    // -f applies after -O, whichever comes first
+    std::vector<const char *> passes;
+    uint64_t times[CYPassCount] = {};
+
     append_history$ = (int (*)(int, const char *)) (dlsym(RTLD_DEFAULT, "append_history"));
 
     const char *device_id(NULL);
@@ -790,16 +1029,22 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
     for (;;) {
         int option(getopt_long(argc, argv,
             "c"
+            "f:"
             "g:"
+            "j:"
             "n:"
+            "O:"
             "d:"
             "p:"
             "r:"
             "s"
         , (const struct option[]) {
             {NULL, no_argument, NULL, 'c'},
+            {NULL, required_argument, NULL, 'f'},
             {NULL, required_argument, NULL, 'g'},
+            {NULL, required_argument, NULL, 'j'},
             {NULL, required_argument, NULL, 'n'},
+            {NULL, required_argument, NULL, 'O'},
             {NULL, required_argument, NULL, 'd'},
             {NULL, required_argument, NULL, 'p'},
             {NULL, required_argument, NULL, 'r'},
@@ -813,11 +1058,14 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
             case ':':
             case '?':
                 fprintf(stderr,
-                    "usage: cycript [-c]"
+                    "usage: cycript [-c [-j <jobs>]]"
+                    " [-O <level>] [-f [no-]<pass>]"
                     " [-d <device-id>]"
                     " [-r <host:port>]"
                     " [-p <pid|name>]"
                     " [<script> [<arg>...]]\n"
+                    "-n stream makes -c write each statement out as soon as it is parsed,"
+                    " so a syntax error may follow some output\n"
                 );
                 return 1;
 
@@ -842,16 +1090,48 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
                     bison_ = true;
                 else if (strcmp(optarg, "timing") == 0)
                     timing_ = true;
+                else if (strcmp(optarg, "passes") == 0)
+                    options.times_ = times;
+                else if (strcmp(optarg, "unicode") == 0)
+                    CYScannerSetASCII(false);
+                else if (strcmp(optarg, "pool") == 0) {
+                    CYPoolSetTracking(true);
+                    pool_ = true;
+                }
                 else {
                     fprintf(stderr, "invalid name for -g\n");
                     return 1;
                 }
             break;
 
+            case 'f':
+                passes.push_back(optarg);
+            break;
+
+            case 'O':
+                if (optarg[0] < '0' || optarg[0] > '1' || optarg[1] != '\0') {
+                    fprintf(stderr, "invalid level for -O\n");
+                    return 1;
+                }
+
+                options.Level(optarg[0] - '0');
+            break;
+
+            case 'j': {
+                char *end;
+                jobs = strtoul(optarg, &end, 10);
+                if (*end != '\0' || jobs == 0) {
+                    fprintf(stderr, "invalid number for -j\n");
+                    return 1;
+                }
+            } break;
+
             case 'n':
                 if (false);
                 else if (strcmp(optarg, "minify") == 0)
                     pretty_ = true;
+                else if (strcmp(optarg, "stream") == 0)
+                    stream_ = true;
                 else {
                     fprintf(stderr, "invalid name for -n\n");
                     return 1;
@@ -883,6 +1163,24 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
     argc -= optind;
     argv += optind;
 
+    for (std::vector<const char *>::const_iterator pass(passes.begin()); pass != passes.end(); ++pass) {
+        bool enable(strncmp(*pass, "no-", 3) != 0);
+        if (!options.Enable(enable ? *pass : *pass + 3, enable)) {
+            fprintf(stderr, "invalid pass for -f\n");
+            return 1;
+        }
+    }
+
+    // with -j, every argument is a script (or @manifest) to compile rather than argv for one
+    if (jobs != 0) {
+        if (!compile) {
+            fprintf(stderr, "-j requires -c\n");
+            return 1;
+        }
+
+        return CYBatch(options, jobs, argc, argv);
+    }
+
     const char *script;
 
     if (process != NULL && argc > 1) {
@@ -928,19 +1226,19 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
             int samples(-50);
             uint64_t start(CYGetTime());
 
-            for (;;) {
-                stream = new std::istringstream(buffer.str());
+            CYPool pool;
+            CYDriver driver(pool, CYUTF8String(""), script);
+            std::string code(buffer.str());
 
-                CYPool pool;
-                CYDriver driver(pool, *stream->rdbuf(), script);
+            for (;;) {
+                CYPoolCheckpoint checkpoint(pool);
+                driver.Reset(pool, CYUTF8String(code.c_str(), code.size()), script);
                 Setup(driver);
 
                 uint64_t begin(CYGetTime());
                 driver.Parse();
                 uint64_t end(CYGetTime());
 
-                delete stream;
-
                 average += (end - begin - average) / ++samples;
 
                 uint64_t now(CYGetTime());
@@ -961,13 +1259,21 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
         CYDriver driver(pool, *stream->rdbuf(), script);
         Setup(driver);
 
-        bool failed(driver.Parse());
+        bool failed;
+        if (!compile || !stream_)
+            failed = driver.Parse();
+        else {
+            // statements are written out as they are parsed, so a script is never held whole
+            CYCompiler compiler(driver, *std::cout.rdbuf(), options);
+            compiler.out_.pretty_ = pretty_;
+            failed = driver.Parse();
+        }
 
         if (failed || !driver.errors_.empty()) {
             for (CYDriver::Errors::const_iterator i(driver.errors_.begin()); i != driver.errors_.end(); ++i)
                 std::cerr << i->location_.begin << ": " << i->message_ << std::endl;
             return 1;
-        } else if (driver.script_ != NULL) {
+        } else if (!(compile && stream_) && driver.script_ != NULL) {
             std::stringbuf str;
             CYOutput out(str, options);
             Setup(out, driver, options, true);
@@ -984,6 +1290,11 @@ int Main(int argc, char * const argv[], char const * const envp[]) {
                 }
             }
         }
+
+        if (pool_)
+            CYPoolReport(std::cerr);
+        if (options.times_ != NULL)
+            CYPassReport(options);
     }
 
     CYDetach();
@@ -20,39 +20,185 @@
 /* }}} */
 
 #include "Driver.hpp"
+#include "Scanner.hpp"
 #include "Syntax.hpp"
 
 bool CYParser(CYPool &pool, bool debug);
 
+static char *CYPoolScanBuffer(CYPool &pool, CYUTF8String data) {
+    char *memory(pool.malloc<char>(data.size + 2, 1));
+    memcpy(memory, data.data, data.size);
+    memory[data.size] = '\0';
+    memory[data.size + 1] = '\0';
+    return memory;
+}
+
+static bool ascii_(true);
+
+_visible void CYScannerSetASCII(bool ascii) {
+    ascii_ = ascii;
+}
+
+static const CYScanner *CYScannerSelect(const char *memory, size_t size) {
+    if (!ascii_ || memory == NULL)
+        return &CYScannerUnicode;
+
+    size_t i(0);
+    for (; size - i >= sizeof(uint64_t); i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, memory + i, sizeof(word));
+        if ((word & 0x8080808080808080ull) != 0)
+            return &CYScannerUnicode;
+    }
+
+    for (; i != size; ++i)
+        if ((memory[i] & 0x80) != 0)
+            return &CYScannerUnicode;
+
+    return &CYScannerASCII;
+}
+
 CYDriver::CYDriver(CYPool &pool, std::streambuf &data, const std::string &filename) :
-    pool_(pool),
-    newline_(false),
-    last_(false),
+    CYDriver(pool, &data, NULL, 0, filename)
+{
+}
+
+CYDriver::CYDriver(CYPool &pool, char *memory, size_t size, const std::string &filename) :
+    CYDriver(pool, NULL, memory, size, filename)
+{
+}
+
+CYDriver::CYDriver(CYPool &pool, CYUTF8String data, const std::string &filename) :
+    CYDriver(pool, NULL, CYPoolScanBuffer(pool, data), data.size, filename)
+{
+}
+
+CYDriver::CYDriver(CYPool &pool, std::streambuf *data, char *memory, size_t size, const std::string &filename) :
+    pool_(&pool),
+    atoms_(pool),
     data_(data),
+    memory_(memory),
+    size_(size),
     debug_(0),
     strict_(false),
     highlight_(false),
     filename_(filename),
-    script_(NULL),
-    auto_(false),
-    context_(NULL),
-    mode_(AutoNone)
+    consumer_(NULL),
+    auto_(false)
 {
+    Clear();
+    pool_->Track("driver");
+    ScannerInit();
+}
+
+CYDriver::~CYDriver() {
+    ScannerDestroy();
+}
+
+void CYDriver::Clear() {
+    buffer_.clear();
+    tail_ = false;
+
+    in_.clear();
+    return_.clear();
+    super_.clear();
+    template_.clear();
+    yield_.clear();
+    class_.clear();
+
     in_.push(false);
     return_.push(false);
     super_.push(false);
     template_.push(false);
     yield_.push(false);
 
-    ScannerInit();
+    newline_ = false;
+    last_ = false;
+
+    script_ = NULL;
+    eval_ = false;
+    errors_.clear();
+    code_ = CYList<CYStatement>();
+
+    contexts_.clear();
+    context_ = NULL;
+    mode_ = AutoNone;
 }
 
-CYDriver::~CYDriver() {
-    ScannerDestroy();
+void CYDriver::Reset(CYPool &pool, std::streambuf &data, const std::string &filename) {
+    Reset(pool, &data, NULL, 0, filename);
+}
+
+void CYDriver::Reset(CYPool &pool, char *memory, size_t size, const std::string &filename) {
+    Reset(pool, NULL, memory, size, filename);
+}
+
+void CYDriver::Reset(CYPool &pool, CYUTF8String data, const std::string &filename) {
+    Reset(pool, NULL, CYPoolScanBuffer(pool, data), data.size, filename);
+}
+
+void CYDriver::Reset(CYPool &pool, std::streambuf *data, char *memory, size_t size, const std::string &filename) {
+    pool_ = &pool;
+    atoms_.Reset(pool);
+
+    data_ = data;
+    memory_ = memory;
+    size_ = size;
+    filename_ = filename;
+
+    Clear();
+    pool_->Track("driver");
+
+    const CYScanner *lexer(CYScannerSelect(memory_, size_));
+    if (lexer == lexer_)
+        ScannerReset();
+    else {
+        ScannerDestroy();
+        ScannerInit();
+    }
+}
+
+void CYDriver::ScannerInit() {
+    lexer_ = CYScannerSelect(memory_, size_);
+    lexer_->init_(*this);
+}
+
+void CYDriver::ScannerReset() {
+    lexer_->reset_(*this);
+}
+
+void CYDriver::ScannerDestroy() {
+    lexer_->destroy_(*this);
+}
+
+void CYDriver::SetRegEx(bool equal) {
+    lexer_->regex_(*this, equal);
+}
+
+void CYDriver::SetCondition(Condition condition) {
+    lexer_->condition_(*this, condition);
+}
+
+void CYDriver::PushCondition(Condition condition) {
+    lexer_->push_(*this, condition);
+}
+
+void CYDriver::PopCondition() {
+    lexer_->pop_(*this);
+}
+
+void CYDriver::Statement(const CYLocation &location, CYStatement *statements) {
+    if (consumer_ != NULL)
+        consumer_->Consume(*this, location, statements);
+    else {
+        CYList<CYStatement> list(statements);
+        code_ ->* list;
+    }
 }
 
 void CYDriver::Replace(CYOptions &options) {
-    CYLocal<CYPool> local(&pool_);
+    CYLocal<CYPool> local(pool_);
     CYContext context(options);
+    context.eval_ = eval_;
     script_->Replace(context);
 }
@@ -24,20 +24,95 @@
 
 #include <iostream>
 
-#include <stack>
 #include <string>
 #include <vector>
 
+#include "Atom.hpp"
+#include "List.hpp"
 #include "Location.hpp"
 #include "Options.hpp"
 #include "Pooling.hpp"
 #include "Standard.hpp"
+#include "String.hpp"
 
 struct CYClassTail;
 struct CYExpression;
+struct CYScanner;
 struct CYScript;
+struct CYStatement;
 struct CYWord;
 
+// keeps its elements inline unless nesting gets unusually deep
+template <typename Type_, size_t Size_>
+class CYStack {
+  private:
+    Type_ inline_[Size_];
+    Type_ *data_;
+    size_t size_;
+    size_t capacity_;
+
+    CYStack(const CYStack &);
+
+  public:
+    CYStack() :
+        data_(inline_),
+        size_(0),
+        capacity_(Size_)
+    {
+    }
+
+    ~CYStack() {
+        if (data_ != inline_)
+            delete [] data_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    Type_ &top() {
+        _assert(size_ != 0);
+        return data_[size_ - 1];
+    }
+
+    void push(const Type_ &value) {
+        if (size_ == capacity_) {
+            Type_ *data(new Type_[capacity_ * 2]);
+            std::copy(data_, data_ + size_, data);
+            if (data_ != inline_)
+                delete [] data_;
+            data_ = data;
+            capacity_ *= 2;
+        }
+
+        data_[size_++] = value;
+    }
+
+    void pop() {
+        _assert(size_ != 0);
+        --size_;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+};
+
+class CYDriver;
+
+// receives each top-level statement as soon as it has been parsed
+class CYConsumer {
+  public:
+    virtual ~CYConsumer() {
+    }
+
+    virtual void Consume(CYDriver &driver, const CYLocation &location, CYStatement *statements) = 0;
+};
+
 enum CYMark {
     CYMarkScript,
     CYMarkModule,
@@ -46,26 +121,30 @@ enum CYMark {
 
 class _visible CYDriver {
   public:
-    CYPool &pool_;
+    CYPool *pool_;
+    CYAtoms atoms_;
+    const CYScanner *lexer_;
     void *scanner_;
 
     std::vector<char> buffer_;
     bool tail_;
 
-    std::stack<bool> in_;
-    std::stack<bool> return_;
-    std::stack<bool> super_;
-    std::stack<bool> template_;
-    std::stack<bool> yield_;
+    CYStack<bool, 32> in_;
+    CYStack<bool, 32> return_;
+    CYStack<bool, 32> super_;
+    CYStack<bool, 32> template_;
+    CYStack<bool, 32> yield_;
 
-    std::stack<CYClassTail *> class_;
+    CYStack<CYClassTail *, 8> class_;
 
     CYMark mark_;
     int hold_;
     bool newline_;
     bool last_;
 
-    std::streambuf &data_;
+    std::streambuf *data_;
+    char *memory_;
+    size_t size_;
 
     int debug_;
     bool strict_;
@@ -81,7 +160,7 @@ class _visible CYDriver {
     struct Error {
         bool warning_;
         CYLocation location_;
-        std::string message_;
+        const char *message_;
     };
 
     typedef std::vector<Error> Errors;
@@ -89,6 +168,13 @@ class _visible CYDriver {
     CYScript *script_;
     Errors errors_;
 
+    // statements are collected here for script_ unless a consumer takes them
+    CYList<CYStatement> code_;
+    CYConsumer *consumer_;
+
+    // set by a direct eval; a consumer clears it once it has replaced the statement
+    bool eval_;
+
     bool auto_;
 
     struct Context {
@@ -121,12 +207,27 @@ class _visible CYDriver {
 
   private:
     void ScannerInit();
+    void ScannerReset();
     void ScannerDestroy();
 
+    void Clear();
+
+    CYDriver(CYPool &pool, std::streambuf *data, char *memory, size_t size, const std::string &filename);
+    void Reset(CYPool &pool, std::streambuf *data, char *memory, size_t size, const std::string &filename);
+
   public:
     CYDriver(CYPool &pool, std::streambuf &data, const std::string &filename = "");
+    // scanned in place: memory must be writable and followed by two NUL bytes
+    CYDriver(CYPool &pool, char *memory, size_t size, const std::string &filename = "");
+    // copied into the pool once, then scanned in place
+    CYDriver(CYPool &pool, CYUTF8String data, const std::string &filename = "");
     ~CYDriver();
 
+    // rebinds the input and pool, keeping the scanner, stacks and buffers allocated
+    void Reset(CYPool &pool, std::streambuf &data, const std::string &filename = "");
+    void Reset(CYPool &pool, char *memory, size_t size, const std::string &filename = "");
+    void Reset(CYPool &pool, CYUTF8String data, const std::string &filename = "");
+
     bool Parse(CYMark mark = CYMarkModule);
     void Replace(CYOptions &options);
 
@@ -137,6 +238,10 @@ class _visible CYDriver {
     void PopCondition();
 
     void Warning(const CYLocation &location, const char *message);
+    void Statement(const CYLocation &location, CYStatement *statements);
 };
 
+// in-place and string input without high bytes is scanned with smaller tables unless this is turned off
+_visible void CYScannerSetASCII(bool ascii);
+
 #endif/*CYCRIPT_DRIVER_HPP*/
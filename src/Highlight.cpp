@@ -19,11 +19,9 @@
 **/
 /* }}} */
 
-#include "Code.hpp"
 #include "Driver.hpp"
 #include "Highlight.hpp"
-
-bool CYLexerHighlight(hi::Value &highlight, CYLocation &location, void *scanner);
+#include "Scanner.hpp"
 
 static void Skip(const char *data, size_t size, std::ostream &output, size_t &offset, CYPosition &current, CYPosition target) {
     while (current.line != target.line || current.column != target.column) {
@@ -57,8 +55,7 @@ struct CYColor {
 _visible void CYLexerHighlight(const char *data, size_t size, std::ostream &output, bool ignore) {
     CYLocalPool pool;
 
-    CYStream stream(data, data + size);
-    CYDriver driver(pool, stream);
+    CYDriver driver(pool, CYUTF8String(data, size));
     driver.highlight_ = true;
 
     size_t offset(0);
@@ -67,7 +64,7 @@ _visible void CYLexerHighlight(const char *data, size_t size, std::ostream &outp
     hi::Value highlight;
     CYLocation location;
 
-    while (CYLexerHighlight(highlight, location, driver.scanner_)) {
+    while (driver.lexer_->highlight_(highlight, location, driver.scanner_)) {
         CYColor color;
 
         switch (highlight) {
@@ -125,32 +125,110 @@ _visible bool CYStartsWith(const CYUTF8String &haystack, const CYUTF8String &nee
     return haystack.size >= needle.size && strncmp(haystack.data, needle.data, needle.size) == 0;
 }
 
-CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream) {
-    CYLocalPool local;
-    CYDriver driver(local, stream);
+CYCompiler::CYCompiler(CYDriver &driver, std::streambuf &out, CYOptions &options) :
+    driver_(driver),
+    base_(driver.pool_),
+    empty_(pools_[0].Checkpoint()),
+    current_(0),
+    unique_(0),
+    carried_(driver.errors_.size()),
+    options_(options),
+    out_(out, options)
+{
+    driver_.pool_ = &pools_[current_];
+    driver_.atoms_.Reset(*driver_.pool_);
+    driver_.consumer_ = this;
+}
 
+CYCompiler::~CYCompiler() {
+    Carry();
+    driver_.consumer_ = NULL;
+    driver_.pool_ = base_;
+    driver_.atoms_.Reset(*base_);
+}
+
+void CYCompiler::Carry() {
+    CYDriver::Errors &errors(driver_.errors_);
+    for (; carried_ != errors.size(); ++carried_)
+        errors[carried_].message_ = base_->strdup(errors[carried_].message_);
+}
+
+void CYCompiler::Consume(CYDriver &driver, const CYLocation &location, CYStatement *statements) {
+    {
+        CYLocal<CYPool> local(driver.pool_);
+        CYContext context(options_);
+        context.unique_ = unique_;
+        context.eval_ = driver.eval_;
+        CYScript script(statements);
+        script.Replace(context);
+        unique_ = context.unique_;
+        out_ << script;
+    }
+
+    // the other pool holds the earlier statements and at most the first token of this one, but
+    // the parser's lookahead is already in the current pool, so only the other one can be emptied
+    driver.eval_ = false;
+    Carry();
+    current_ ^= 1;
+    pools_[current_].Rewind(empty_);
+    driver.pool_ = &pools_[current_];
+    // spellings already interned stay valid as long as the tokens using them, but are no longer shared
+    driver.atoms_.Reset(*driver.pool_);
+}
+
+static void CYParseCode(CYDriver &driver) {
     if (driver.Parse()) {
         if (!driver.errors_.empty())
-            CYThrow("%s", driver.errors_.front().message_.c_str());
+            CYThrow("%s", driver.errors_.front().message_);
         CYThrow("syntax error");
     }
+}
 
-    CYOptions options;
-    CYContext context(options);
-    driver.script_->Replace(context);
-
+static CYUTF8String CYPoolCode(CYPool &pool, CYDriver &driver, CYOptions &options, bool streaming) {
     std::stringbuf str;
-    CYOutput out(str, options);
-    out << *driver.script_;
+
+    if (streaming) {
+        CYCompiler compiler(driver, str, options);
+        CYParseCode(driver);
+    } else {
+        CYParseCode(driver);
+        CYOutput out(str, options);
+        driver.Replace(options);
+        out << *driver.script_;
+    }
+
     return pool.strdup(str.str().c_str());
 }
 
+CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream, CYOptions &options, bool streaming) {
+    CYLocalPool local;
+    CYDriver driver(local, stream);
+    return CYPoolCode(pool, driver, options, streaming);
+}
+
+CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream, CYOptions &options) {
+    return CYPoolCode(pool, stream, options, false);
+}
+
+CYUTF8String CYPoolCode(CYPool &pool, std::streambuf &stream) {
+    CYOptions options;
+    return CYPoolCode(pool, stream, options);
+}
+
+CYUTF8String CYPoolCode(CYPool &pool, CYUTF8String code, CYOptions &options) {
+    CYLocalPool local;
+    CYDriver driver(local, code);
+    return CYPoolCode(pool, driver, options, false);
+}
+
 CYUTF8String CYPoolCode(CYPool &pool, CYUTF8String code) {
-    CYStream stream(code.data, code.data + code.size);
-    return CYPoolCode(pool, stream);
+    CYOptions options;
+    return CYPoolCode(pool, code, options);
 }
 
-CYPool &CYGetGlobalPool() {
+_visible CYPool &CYGetGlobalPool() {
     static CYPool pool;
+    // Track is not synchronized, so only the thread initializing this calls it
+    _disused static bool tracked((pool.Track("global"), true));
     return pool;
 }
@@ -22,86 +22,31 @@
 #ifndef CYCRIPT_LOCAL_HPP
 #define CYCRIPT_LOCAL_HPP
 
-#ifdef _WIN32
-
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-
-typedef DWORD CYLocalKey;
-
+// a plain pointer needs no dynamic initialization, so Get() is a direct TLS access
 template <typename Type_>
 class CYLocal {
   private:
-    static CYLocalKey key_;
+    static thread_local Type_ *value_;
 
     Type_ *last_;
 
-  protected:
-    static _finline void Set(Type_ *value) {
-        _assert(::TlsSetValue(key_, value));
-    }
-
-    static CYLocalKey Key_() {
-        return ::TlsAlloc();
-    }
-
   public:
-    CYLocal(Type_ *next) {
-        last_ = Get();
-        Set(next);
+    _finline CYLocal(Type_ *next) :
+        last_(value_)
+    {
+        value_ = next;
     }
 
     _finline ~CYLocal() {
-        Set(last_);
+        value_ = last_;
     }
 
     static _finline Type_ *Get() {
-        return static_cast<Type_ *>(::TlsGetValue(key_));
+        return value_;
     }
 };
 
-#else
-
-#include <pthread.h>
-
-typedef ::pthread_key_t CYLocalKey;
-
-template <typename Type_>
-class CYLocal {
-  private:
-    static CYLocalKey key_;
-
-    Type_ *last_;
-
-  protected:
-    static _finline void Set(Type_ *value) {
-        _assert(::pthread_setspecific(key_, value) == 0);
-    }
-
-    static CYLocalKey Key_() {
-        CYLocalKey key;
-        ::pthread_key_create(&key, NULL);
-        return key;
-    }
-
-  public:
-    CYLocal(Type_ *next) {
-        last_ = Get();
-        Set(next);
-    }
-
-    _finline ~CYLocal() {
-        Set(last_);
-    }
-
-    static _finline Type_ *Get() {
-        return reinterpret_cast<Type_ *>(::pthread_getspecific(key_));
-    }
-};
-
-#endif
-
 template <typename Type_>
-CYLocalKey CYLocal<Type_>::key_ = Key_();
+thread_local Type_ *CYLocal<Type_>::value_;
 
 #endif/*CYCRIPT_LOCAL_HPP*/
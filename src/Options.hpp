@@ -22,12 +22,73 @@
 #ifndef CYCRIPT_OPTIONS_HPP
 #define CYCRIPT_OPTIONS_HPP
 
+#include <cstring>
+#include <stdint.h>
+
+// lowering always runs; the passes after it each start at an -O level and can be toggled on their own
+enum CYPass {
+    CYPassLower,
+    CYPassFold,
+    CYPassEliminate,
+    CYPassInline,
+    CYPassRename,
+    CYPassCount,
+};
+
+struct CYPassInfo {
+    const char *name_;
+    unsigned level_;
+};
+
+static const CYPassInfo CYPasses_[CYPassCount] = {
+    {"lower", 0},
+    {"fold", 1},
+    {"eliminate", 1},
+    {"inline", 1},
+    {"rename", 1},
+};
+
 struct CYOptions {
     bool verbose_;
+    unsigned passes_;
+
+    // if set, the nanoseconds spent in each pass are added here
+    uint64_t *times_;
+    // the pass being timed, if any, and when it last started or resumed
+    CYPass timing_;
+    uint64_t mark_;
 
     CYOptions() :
-        verbose_(false)
+        verbose_(false),
+        times_(NULL),
+        timing_(CYPassCount),
+        mark_(0)
     {
+        Level(1);
+    }
+
+    void Level(unsigned level) {
+        passes_ = 0;
+        for (unsigned pass(0); pass != CYPassCount; ++pass)
+            if (CYPasses_[pass].level_ <= level)
+                passes_ |= 1 << pass;
+    }
+
+    bool Enabled(CYPass pass) const {
+        return (passes_ & 1 << pass) != 0;
+    }
+
+    // lower cannot be turned off, as the output would not be JavaScript
+    bool Enable(const char *name, bool enable) {
+        for (unsigned pass(1); pass != CYPassCount; ++pass)
+            if (strcmp(CYPasses_[pass].name_, name) == 0) {
+                if (enable)
+                    passes_ |= 1 << pass;
+                else
+                    passes_ &= ~(1 << pass);
+                return true;
+            }
+        return false;
     }
 };
 
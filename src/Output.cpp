@@ -20,6 +20,8 @@
 /* }}} */
 
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -182,10 +184,49 @@ void CYNumerify(std::ostringstream &str, double value) {
         return;
     }
 
+    if (std::isnan(value)) {
+        str << "NaN";
+        return;
+    }
+
+    if (value == 0) {
+        str << '0';
+        return;
+    } else if (value < 0) {
+        str << '-';
+        value = -value;
+    }
+
+    // the fewest digits that still read back as the same number, as Number.prototype.toString
     char string[32];
+    for (int precision(1); ; ++precision) {
+        sprintf(string, "%.*e", precision - 1, value);
+        if (precision == 17 || strtod(string, NULL) == value)
+            break;
+    }
+
+    char *exponent(strchr(string, 'e'));
+    std::string digits(string, 1);
+    if (string[1] == '.')
+        digits.append(string + 2, exponent);
+    digits.erase(digits.find_last_not_of('0') + 1);
+
+    int size(digits.size());
+    int point(atoi(exponent + 1) + 1);
+
     // XXX: I want this to print 1e3 rather than 1000
-    sprintf(string, "%.17g", value);
-    str << string;
+    if (size <= point && point <= 21)
+        str << digits << std::string(point - size, '0');
+    else if (0 < point && point <= 21)
+        str << digits.substr(0, point) << '.' << digits.substr(point);
+    else if (-6 < point && point <= 0)
+        str << "0." << std::string(-point, '0') << digits;
+    else {
+        str << digits[0];
+        if (size != 1)
+            str << '.' << digits.substr(1);
+        str << 'e' << (point > 0 ? '+' : '-') << std::abs(point - 1);
+    }
 }
 
 void CYOutput::Terminate() {
@@ -443,7 +484,6 @@ void CYDebugger::Output(CYOutput &out, CYFlags flags) const {
 
 void CYBinding::Output(CYOutput &out, CYFlags flags) const {
     out << *identifier_;
-    //out.out_ << ':' << identifier_->usage_ << '#' << identifier_->offset_;
     if (initializer_ != NULL) {
         out << ' ' << '=' << ' ';
         initializer_->Output(out, CYAssign::Precedence_, CYRight(flags));
@@ -894,8 +934,8 @@ void CYNumber::Output(CYOutput &out, CYFlags flags) const {
     CYNumerify(str, Value());
     std::string value(str.str());
     out << value.c_str();
-    // XXX: this should probably also handle hex conversions and exponents
-    if ((flags & CYNoInteger) != 0 && value.find('.') == std::string::npos)
+    // XXX: this should probably also handle hex conversions
+    if ((flags & CYNoInteger) != 0 && value.find_first_of(".e") == std::string::npos)
         out << '.';
 }
 
@@ -0,0 +1,308 @@
+/* Cycript - The Truly Universal Scripting Language
+ * Copyright (C) 2009-2016  Jay Freeman (saurik)
+*/
+
+/* GNU Affero General Public License, Version 3 {{{ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/* }}} */
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+
+#include "Pooling.hpp"
+
+// chunks are recycled in power-of-two classes from 64 bytes through 1 megabyte
+static const unsigned CYPoolMinimum(6);
+static const unsigned CYPoolClasses(15);
+
+// each thread keeps up to this many bytes (and at least one chunk) per class
+static const size_t CYPoolCacheBytes(256 * 1024);
+static const size_t CYPoolCacheDepth(16);
+
+// the shared depot holds whatever the thread caches overflow or leave behind
+static const size_t CYPoolDepotFactor(4);
+
+struct CYPoolFree {
+    CYPoolFree *next_;
+};
+
+static size_t CYPoolDepth(unsigned index) {
+    size_t depth(CYPoolCacheBytes >> (CYPoolMinimum + index));
+    return std::max<size_t>(1, std::min(depth, CYPoolCacheDepth));
+}
+
+static bool CYPoolClass(size_t size, unsigned &index) {
+    for (index = 0; index != CYPoolClasses; ++index)
+        if (size <= size_t(1) << (CYPoolMinimum + index))
+            return true;
+    return false;
+}
+
+namespace {
+
+struct CYPoolList {
+    CYPoolFree *free_;
+    size_t count_;
+
+    _finline void *Pop() {
+        CYPoolFree *free(free_);
+        free_ = free->next_;
+        --count_;
+        return free;
+    }
+
+    _finline void Push(void *data) {
+        CYPoolFree *free(reinterpret_cast<CYPoolFree *>(data));
+        free->next_ = free_;
+        free_ = free;
+        ++count_;
+    }
+};
+
+struct CYPoolDepot {
+    std::mutex mutex_;
+    CYPoolList lists_[CYPoolClasses];
+
+    ~CYPoolDepot();
+};
+
+// this is constant-initialized, so it is destroyed after any static pool, which has to be constructed at runtime
+CYPoolDepot depot_;
+
+CYPoolDepot::~CYPoolDepot() {
+    for (unsigned index(0); index != CYPoolClasses; ++index) {
+        CYPoolList &list(lists_[index]);
+        while (list.count_ != 0)
+            ::free(list.Pop());
+    }
+}
+
+// plain data without a destructor, so pools destroyed after the teardown below can still see it is closed
+struct CYPoolCache {
+    CYPoolList lists_[CYPoolClasses];
+    bool closed_;
+};
+
+thread_local CYPoolCache cache_;
+
+// hands the thread's chunks to the depot once the thread ends; anything released later goes there directly
+struct CYPoolTeardown {
+    ~CYPoolTeardown() {
+        cache_.closed_ = true;
+
+        std::lock_guard<std::mutex> lock(depot_.mutex_);
+        for (unsigned index(0); index != CYPoolClasses; ++index) {
+            CYPoolList &list(cache_.lists_[index]);
+            CYPoolList &depot(depot_.lists_[index]);
+            size_t limit(CYPoolDepth(index) * CYPoolDepotFactor);
+            while (list.count_ != 0) {
+                void *data(list.Pop());
+                if (depot.count_ < limit)
+                    depot.Push(data);
+                else
+                    ::free(data);
+            }
+        }
+    }
+};
+
+static CYPoolCache *CYPoolLocal() {
+    if (cache_.closed_)
+        return NULL;
+    // the first use on a thread registers the teardown of its cache
+    static thread_local CYPoolTeardown teardown;
+    (void) teardown;
+    return &cache_;
+}
+
+}
+
+size_t CYPoolRound(size_t size) {
+    unsigned index;
+    if (!CYPoolClass(size, index))
+        return size;
+    return size_t(1) << (CYPoolMinimum + index);
+}
+
+void *CYPoolAcquire(size_t &size) {
+    unsigned index;
+    if (!CYPoolClass(size, index)) {
+        void *data(::malloc(size));
+        _assert(data != NULL);
+        return data;
+    }
+
+    size = size_t(1) << (CYPoolMinimum + index);
+
+    if (CYPoolCache *cache = CYPoolLocal()) {
+        CYPoolList &list(cache->lists_[index]);
+        if (list.count_ != 0)
+            return list.Pop();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(depot_.mutex_);
+        CYPoolList &depot(depot_.lists_[index]);
+        if (depot.count_ != 0)
+            return depot.Pop();
+    }
+
+    void *data(::malloc(size));
+    _assert(data != NULL);
+    return data;
+}
+
+void CYPoolRelease(void *data, size_t size) {
+    unsigned index;
+    if (!CYPoolClass(size, index)) {
+        ::free(data);
+        return;
+    }
+
+    if (CYPoolCache *cache = CYPoolLocal()) {
+        CYPoolList &list(cache->lists_[index]);
+        if (list.count_ < CYPoolDepth(index)) {
+            list.Push(data);
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(depot_.mutex_);
+        CYPoolList &depot(depot_.lists_[index]);
+        if (depot.count_ < CYPoolDepth(index) * CYPoolDepotFactor) {
+            depot.Push(data);
+            return;
+        }
+    }
+
+    ::free(data);
+}
+
+namespace {
+
+struct CYPoolRegistry {
+    std::atomic<bool> tracking_;
+    std::mutex mutex_;
+    CYPoolStatistics *live_;
+    // one record per name, summing every pool of that name since destroyed
+    CYPoolStatistics *retired_;
+};
+
+CYPoolRegistry registry_;
+
+}
+
+void CYPoolSetTracking(bool tracking) {
+    registry_.tracking_ = tracking;
+}
+
+CYPoolStatistics *CYPoolRegister(const char *name) {
+    if (!registry_.tracking_)
+        return NULL;
+
+    CYPoolStatistics *statistics(new CYPoolStatistics());
+    statistics->name_ = name;
+    statistics->pools_ = 1;
+
+    std::lock_guard<std::mutex> lock(registry_.mutex_);
+    statistics->next_ = registry_.live_;
+    registry_.live_ = statistics;
+    return statistics;
+}
+
+static CYPoolStatistics *CYPoolFind(CYPoolStatistics *&list, const char *name) {
+    for (CYPoolStatistics *statistics(list); statistics != NULL; statistics = statistics->next_)
+        if (strcmp(statistics->name_, name) == 0)
+            return statistics;
+
+    CYPoolStatistics *statistics(new CYPoolStatistics());
+    statistics->name_ = name;
+    statistics->next_ = list;
+    list = statistics;
+    return statistics;
+}
+
+static void CYPoolFold(CYPoolStatistics &total, const CYPoolStatistics &statistics) {
+    total.pools_ += statistics.pools_;
+    total.allocations_ += statistics.allocations_;
+    total.bytes_ += statistics.bytes_;
+    total.chunks_ += statistics.chunks_;
+    total.large_ += statistics.large_;
+    total.cleaners_ += statistics.cleaners_;
+    total.reserved_ += statistics.reserved_;
+    total.peak_ = std::max(total.peak_, statistics.peak_);
+    total.waste_ += statistics.waste_;
+}
+
+void CYPoolRetire(CYPoolStatistics *statistics) {
+    std::lock_guard<std::mutex> lock(registry_.mutex_);
+
+    for (CYPoolStatistics **next(&registry_.live_); *next != NULL; next = &(*next)->next_)
+        if (*next == statistics) {
+            *next = statistics->next_;
+            break;
+        }
+
+    // chunks are all released by now, so this only folds the running totals
+    CYPoolFold(*CYPoolFind(registry_.retired_, statistics->name_), *statistics);
+    delete statistics;
+}
+
+void CYPoolReport(std::ostream &out) {
+    CYPoolStatistics *totals(NULL);
+
+    {
+        std::lock_guard<std::mutex> lock(registry_.mutex_);
+        // XXX: live pools are read while their owners may still be allocating
+        for (CYPoolStatistics *statistics(registry_.live_); statistics != NULL; statistics = statistics->next_)
+            CYPoolFold(*CYPoolFind(totals, statistics->name_), *statistics);
+        for (CYPoolStatistics *statistics(registry_.retired_); statistics != NULL; statistics = statistics->next_)
+            CYPoolFold(*CYPoolFind(totals, statistics->name_), *statistics);
+    }
+
+    out << std::left << std::setw(8) << "pool" << std::right;
+    out << std::setw(8) << "pools";
+    out << std::setw(12) << "allocs";
+    out << std::setw(12) << "bytes";
+    out << std::setw(8) << "chunks";
+    out << std::setw(8) << "large";
+    out << std::setw(10) << "cleaners";
+    out << std::setw(12) << "reserved";
+    out << std::setw(12) << "peak";
+    out << std::setw(12) << "waste";
+    out << std::endl;
+
+    for (CYPoolStatistics *statistics(totals); statistics != NULL; ) {
+        out << std::left << std::setw(8) << statistics->name_ << std::right;
+        out << std::setw(8) << statistics->pools_;
+        out << std::setw(12) << statistics->allocations_;
+        out << std::setw(12) << statistics->bytes_;
+        out << std::setw(8) << statistics->chunks_;
+        out << std::setw(8) << statistics->large_;
+        out << std::setw(10) << statistics->cleaners_;
+        out << std::setw(12) << statistics->reserved_;
+        out << std::setw(12) << statistics->peak_;
+        out << std::setw(12) << statistics->waste_;
+        out << std::endl;
+
+        CYPoolStatistics *next(statistics->next_);
+        delete statistics;
+        statistics = next;
+    }
+}
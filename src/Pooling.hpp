@@ -28,6 +28,7 @@
 #include <cstring>
 
 #include <algorithm>
+#include <iosfwd>
 
 #ifdef _MSC_VER
 #include <malloc.h>
@@ -46,6 +47,33 @@ static void CYAlign(Type_ &data, size_t size) {
     data = (Type_)((((uintptr_t)data) + (size - 1)) & ~static_cast<uintptr_t>(size - 1));
 }
 
+// chunks are handed back to a size-classed recycler rather than to free()
+_visible void *CYPoolAcquire(size_t &size);
+// the size CYPoolAcquire will actually hand out for a request of this size
+_visible size_t CYPoolRound(size_t size);
+_visible void CYPoolRelease(void *data, size_t size);
+
+struct CYPoolStatistics {
+    const char *name_;
+    CYPoolStatistics *next_;
+
+    size_t pools_;
+    size_t allocations_;
+    size_t bytes_;
+    size_t chunks_;
+    size_t large_;
+    size_t cleaners_;
+    size_t reserved_;
+    size_t peak_;
+    size_t waste_;
+};
+
+// accounting is optional: pools only keep counters once tracked while tracking is enabled
+_visible void CYPoolSetTracking(bool tracking);
+_visible CYPoolStatistics *CYPoolRegister(const char *name);
+_visible void CYPoolRetire(CYPoolStatistics *statistics);
+_visible void CYPoolReport(std::ostream &out);
+
 class CYPool;
 _finline void *operator new(size_t size, CYPool &pool);
 _finline void *operator new [](size_t size, CYPool &pool);
@@ -56,6 +84,16 @@ class CYPool {
     size_t size_;
     size_t next_;
 
+    size_t maximum_;
+    size_t limit_;
+    size_t reserved_;
+    size_t peak_;
+
+    struct Chunk {
+        Chunk *next_;
+        size_t size_;
+    } *chunk_, *large_;
+
     struct Cleaner {
         Cleaner *next_;
         void (*code_)(void *);
@@ -69,6 +107,8 @@ class CYPool {
         }
     } *cleaner_;
 
+    CYPoolStatistics *statistics_;
+
     template <typename Type_>
     static void delete_(void *data) {
         reinterpret_cast<Type_ *>(data)->~Type_();
@@ -76,12 +116,73 @@ class CYPool {
 
     CYPool(const CYPool &);
 
+    Chunk *Acquire(Chunk *&list, size_t size) {
+        size = CYPoolRound(size);
+        if (limit_ != 0 && reserved_ + size > limit_)
+            CYThrow("pool limit of %lu bytes exceeded", static_cast<unsigned long>(limit_));
+
+        Chunk *chunk(reinterpret_cast<Chunk *>(CYPoolAcquire(size)));
+        chunk->next_ = list;
+        chunk->size_ = size;
+        list = chunk;
+
+        reserved_ += size;
+        peak_ = std::max(peak_, reserved_);
+
+        if (statistics_ != NULL) {
+            statistics_->reserved_ += size;
+            statistics_->peak_ = std::max(statistics_->peak_, statistics_->reserved_);
+        }
+
+        return chunk;
+    }
+
+    void Release(Chunk *&chunk, Chunk *mark) {
+        while (chunk != mark) {
+            Chunk *next(chunk->next_);
+            reserved_ -= chunk->size_;
+            if (statistics_ != NULL)
+                statistics_->reserved_ -= chunk->size_;
+            CYPoolRelease(chunk, chunk->size_);
+            chunk = next;
+        }
+    }
+
+    // allocations this large that would not fit get a block to themselves
+    static const size_t Large_ = 1024;
+
+    void *Large(size_t need, size_t alignment) {
+        Chunk *chunk(Acquire(large_, need));
+        if (statistics_ != NULL)
+            ++statistics_->large_;
+
+        uint8_t *data(reinterpret_cast<uint8_t *>(chunk + 1));
+        CYAlign(data, alignment);
+        return data;
+    }
+
   public:
+    struct Mark {
+        uint8_t *data_;
+        size_t size_;
+        size_t next_;
+        Chunk *chunk_;
+        Chunk *large_;
+        Cleaner *cleaner_;
+    };
+
     CYPool(size_t next = 64) :
         data_(NULL),
         size_(0),
         next_(next),
-        cleaner_(NULL)
+        maximum_(1024 * 1024),
+        limit_(0),
+        reserved_(0),
+        peak_(0),
+        chunk_(NULL),
+        large_(NULL),
+        cleaner_(NULL),
+        statistics_(NULL)
     {
     }
 
@@ -91,22 +192,99 @@ class CYPool {
             (*cleaner->code_)(cleaner->data_);
             cleaner = next;
         }
+
+        Release(chunk_, NULL);
+        Release(large_, NULL);
+
+        if (statistics_ != NULL)
+            CYPoolRetire(statistics_);
+    }
+
+    // chunks stop doubling at this size; bigger requests still get what they need
+    void SetMaximum(size_t maximum) {
+        maximum_ = maximum;
+    }
+
+    // a soft cap on reserved memory: allocating past it throws instead
+    void SetLimit(size_t limit) {
+        limit_ = limit;
+    }
+
+    size_t Reserved() const {
+        return reserved_;
+    }
+
+    // the high-water mark of reserved memory
+    size_t Peak() const {
+        return peak_;
+    }
+
+    // the chunks the pool already holds are counted too, as releasing them will take them off
+    void Track(const char *name) {
+        if (statistics_ != NULL)
+            return;
+        statistics_ = CYPoolRegister(name);
+        if (statistics_ == NULL)
+            return;
+
+        for (Chunk *chunk(chunk_); chunk != NULL; chunk = chunk->next_)
+            ++statistics_->chunks_;
+        for (Chunk *chunk(large_); chunk != NULL; chunk = chunk->next_)
+            ++statistics_->large_;
+        statistics_->reserved_ = reserved_;
+        statistics_->peak_ = reserved_;
+    }
+
+    Mark Checkpoint() const {
+        Mark mark = {data_, size_, next_, chunk_, large_, cleaner_};
+        return mark;
+    }
+
+    // runs the cleaners and returns the chunks registered since the mark
+    void Rewind(const Mark &mark) {
+        while (cleaner_ != mark.cleaner_) {
+            Cleaner *cleaner(cleaner_);
+            cleaner_ = cleaner->next_;
+            (*cleaner->code_)(cleaner->data_);
+        }
+
+        Release(chunk_, mark.chunk_);
+        Release(large_, mark.large_);
+
+        data_ = mark.data_;
+        size_ = mark.size_;
+        next_ = mark.next_;
     }
 
     template <typename Type_>
     Type_ *malloc(size_t size, size_t alignment = CYAlignment) {
+        if (statistics_ != NULL) {
+            ++statistics_->allocations_;
+            statistics_->bytes_ += size;
+        }
+
         uint8_t *end(data_);
         CYAlign(end, alignment);
         end += size;
 
         if (size_t(end - data_) > size_) {
-            size_t need(sizeof(Cleaner));
+            size_t need(sizeof(Chunk));
             CYAlign(need, alignment);
             need += size;
-            size_ = std::max<size_t>(next_, need);
-            next_ *= 2;
-            data_ = reinterpret_cast<uint8_t *>(::malloc(size_));
-            atexit(free, data_);
+
+            if (size >= Large_ && need > next_ / 2)
+                return reinterpret_cast<Type_ *>(Large(need, alignment));
+
+            Chunk *chunk(Acquire(chunk_, std::max<size_t>(next_, need)));
+            next_ = std::min(next_ * 2, std::max(next_, maximum_));
+
+            if (statistics_ != NULL) {
+                ++statistics_->chunks_;
+                statistics_->waste_ += size_;
+            }
+
+            data_ = reinterpret_cast<uint8_t *>(chunk + 1);
+            size_ = chunk->size_ - sizeof(Chunk);
             _assert(size <= size_);
         }
 
@@ -231,6 +409,8 @@ _finline void *operator new [](size_t size, CYPool &pool) {
 
 _finline void CYPool::atexit(void (*code)(void *), void *data) {
     cleaner_ = new(*this) Cleaner(cleaner_, code, data);
+    if (statistics_ != NULL)
+        ++statistics_->cleaners_;
 }
 
 struct CYData {
@@ -321,6 +501,23 @@ struct CYPoolAllocator {
     };
 };
 
+class CYPoolCheckpoint {
+  private:
+    CYPool &pool_;
+    CYPool::Mark mark_;
+
+  public:
+    CYPoolCheckpoint(CYPool &pool) :
+        pool_(pool),
+        mark_(pool.Checkpoint())
+    {
+    }
+
+    ~CYPoolCheckpoint() {
+        pool_.Rewind(mark_);
+    }
+};
+
 class CYLocalPool :
     public CYPool
 {
@@ -19,8 +19,12 @@
 **/
 /* }}} */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iomanip>
-#include <map>
+#include <sstream>
 
 #include "Replace.hpp"
 #include "Syntax.hpp"
@@ -47,37 +51,328 @@ static void CYImplicitReturn(CYStatement *&code) {
         last = last->Return();
 }
 
-CYExpression *CYAdd::Replace(CYContext &context) {
-    CYInfix::Replace(context);
-
-    CYString *lhs(dynamic_cast<CYString *>(lhs_));
-    CYString *rhs(dynamic_cast<CYString *>(rhs_));
-
-    if (lhs != NULL || rhs != NULL) {
-        if (lhs == NULL) {
-            lhs = lhs_->String(context);
-            if (lhs == NULL)
-                return this;
-        } else if (rhs == NULL) {
-            rhs = rhs_->String(context);
-            if (rhs == NULL)
-                return this;
+// operands have already been replaced, so any that can be folded are literals by now
+static bool CYConstant(CYExpression *value) {
+    for (;;)
+        if (CYParenthetical *parenthetical = dynamic_cast<CYParenthetical *>(value))
+            value = parenthetical->expression_;
+        else if (CYNegate *negate = dynamic_cast<CYNegate *>(value))
+            value = negate->rhs_;
+        else
+            return dynamic_cast<CYTrivial *>(value) != NULL;
+}
+
+// values from Primitive() can be negative or NaN, which have no literal of their own
+static CYExpression *CYLiteralize(CYContext &context, CYExpression *value) {
+    CYNumber *number(dynamic_cast<CYNumber *>(value));
+    if (number == NULL)
+        return value;
+    double result(number->Value());
+    if (!std::isfinite(result))
+        return NULL;
+    if (std::signbit(result))
+        return $ CYNegate($D(-result));
+    return number;
+}
+
+static CYExpression *CYFold(CYContext &context, CYInfix *infix) {
+    if (CYConstant(infix->lhs_) && CYConstant(infix->rhs_))
+        if (CYExpression *value = CYLiteralize(context, infix->Primitive(context)))
+            return value;
+    return infix;
+}
+
+static CYExpression *CYFold(CYContext &context, CYPrefix *prefix) {
+    if (CYConstant(prefix->rhs_))
+        if (CYExpression *value = CYLiteralize(context, prefix->Primitive(context)))
+            return value;
+    return prefix;
+}
+
+// StringToNumber, though only for ASCII: anything else is left for the engine
+static bool CYStringToNumber(const char *data, size_t size, double &number) {
+    size_t begin(0), end(size);
+    for (size_t i(0); i != size; ++i)
+        if ((data[i] & 0x80) != 0)
+            return false;
+
+    while (begin != end && (data[begin] == ' ' || data[begin] >= '\t' && data[begin] <= '\r'))
+        ++begin;
+    while (end != begin && (data[end - 1] == ' ' || data[end - 1] >= '\t' && data[end - 1] <= '\r'))
+        --end;
+
+    std::string text(data + begin, end - begin);
+    number = NAN;
+
+    if (text.empty()) {
+        number = 0;
+        return true;
+    }
+
+    if (text.size() > 2 && text[0] == '0') {
+        int base;
+        switch (text[1]) {
+            case 'x': case 'X': base = 16; break;
+            case 'o': case 'O': base = 8; break;
+            case 'b': case 'B': base = 2; break;
+            default: base = 0; break;
+        }
+
+        if (base != 0) {
+            double value(0);
+            for (size_t i(2); i != text.size(); ++i) {
+                char digit(text[i]);
+                int index;
+                if (digit >= '0' && digit <= '9')
+                    index = digit - '0';
+                else if (digit >= 'a' && digit <= 'f')
+                    index = digit - 'a' + 10;
+                else if (digit >= 'A' && digit <= 'F')
+                    index = digit - 'A' + 10;
+                else
+                    return true;
+                if (index >= base)
+                    return true;
+                value = value * base + index;
+            }
+
+            // past 2^53 the sum above stops being exact
+            if (value >= 9007199254740992.0)
+                return false;
+            number = value;
+            return true;
         }
+    }
 
-        return lhs->Concat(context, rhs);
+    size_t i(0);
+    if (text[i] == '+' || text[i] == '-')
+        ++i;
+    if (text.compare(i, std::string::npos, "Infinity") == 0)
+        return false;
+
+    size_t digits(0);
+    for (; i != text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+        ++digits;
+    if (i != text.size() && text[i] == '.')
+        for (++i; i != text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+            ++digits;
+    if (digits == 0)
+        return true;
+
+    if (i != text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        if (++i != text.size() && (text[i] == '+' || text[i] == '-'))
+            ++i;
+        if (i == text.size())
+            return true;
+        for (; i != text.size() && text[i] >= '0' && text[i] <= '9'; ++i);
     }
 
-    if (CYNumber *lhn = lhs_->Number(context))
-        if (CYNumber *rhn = rhs_->Number(context))
-            return $D(lhn->Value() + rhn->Value());
+    if (i != text.size())
+        return true;
 
-    return this;
+    number = strtod(text.c_str(), NULL);
+    return std::isfinite(number);
+}
+
+static bool CYToNumber(CYContext &context, CYExpression *value, double &number) {
+    if (value == NULL)
+        return false;
+    if (CYString *string = dynamic_cast<CYString *>(value))
+        return CYStringToNumber(string->value_, string->size_, number);
+    if (CYNumber *numeric = value->Number(context)) {
+        number = numeric->Value();
+        return true;
+    }
+    return false;
+}
+
+static bool CYToNumbers(CYContext &context, CYExpression *lhs, CYExpression *rhs, double &lhn, double &rhn) {
+    return CYToNumber(context, lhs->Primitive(context), lhn) && CYToNumber(context, rhs->Primitive(context), rhn);
+}
+
+static uint32_t CYToUint32(double value) {
+    if (!std::isfinite(value))
+        return 0;
+    double modulus(std::fmod(std::trunc(value), 4294967296.0));
+    if (modulus < 0)
+        modulus += 4294967296.0;
+    return uint32_t(modulus);
+}
+
+static int32_t CYToInt32(double value) {
+    return int32_t(CYToUint32(value));
+}
+
+enum CYPrimitiveKind {
+    CYPrimitiveOther,
+    CYPrimitiveNull,
+    CYPrimitiveBoolean,
+    CYPrimitiveNumber,
+    CYPrimitiveString,
+};
+
+static CYPrimitiveKind CYKind(CYExpression *value) {
+    if (dynamic_cast<CYNull *>(value) != NULL)
+        return CYPrimitiveNull;
+    if (dynamic_cast<CYBoolean *>(value) != NULL)
+        return CYPrimitiveBoolean;
+    if (dynamic_cast<CYNumber *>(value) != NULL)
+        return CYPrimitiveNumber;
+    if (dynamic_cast<CYString *>(value) != NULL)
+        return CYPrimitiveString;
+    return CYPrimitiveOther;
+}
+
+static bool CYToBoolean(CYContext &context, CYExpression *value, bool &truth) {
+    value = value->Primitive(context);
+    switch (CYKind(value)) {
+        case CYPrimitiveNull:
+            truth = false;
+            return true;
+        case CYPrimitiveBoolean:
+            truth = static_cast<CYBoolean *>(value)->Value();
+            return true;
+        case CYPrimitiveNumber: {
+            double number(static_cast<CYNumber *>(value)->Value());
+            truth = number != 0 && !std::isnan(number);
+        } return true;
+        case CYPrimitiveString:
+            truth = static_cast<CYString *>(value)->size_ != 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool CYStrictEquals(CYContext &context, CYExpression *lhs, CYExpression *rhs, bool &equal) {
+    lhs = lhs->Primitive(context);
+    rhs = rhs->Primitive(context);
+
+    CYPrimitiveKind kind(CYKind(lhs));
+    if (kind == CYPrimitiveOther || CYKind(rhs) == CYPrimitiveOther)
+        return false;
+
+    if (kind != CYKind(rhs))
+        equal = false;
+    else switch (kind) {
+        case CYPrimitiveNull:
+            equal = true;
+            break;
+        case CYPrimitiveBoolean:
+            equal = static_cast<CYBoolean *>(lhs)->Value() == static_cast<CYBoolean *>(rhs)->Value();
+            break;
+        case CYPrimitiveNumber:
+            equal = static_cast<CYNumber *>(lhs)->Value() == static_cast<CYNumber *>(rhs)->Value();
+            break;
+        case CYPrimitiveString: {
+            CYString *lhstr(static_cast<CYString *>(lhs));
+            CYString *rhstr(static_cast<CYString *>(rhs));
+            equal = lhstr->size_ == rhstr->size_ && memcmp(lhstr->value_, rhstr->value_, lhstr->size_) == 0;
+        } break;
+        default:
+            _assert(false);
+    }
+
+    return true;
+}
+
+static bool CYLooseEquals(CYContext &context, CYExpression *lhs, CYExpression *rhs, bool &equal) {
+    CYPrimitiveKind lhk(CYKind(lhs->Primitive(context)));
+    CYPrimitiveKind rhk(CYKind(rhs->Primitive(context)));
+
+    if (lhk == CYPrimitiveOther || rhk == CYPrimitiveOther)
+        return false;
+    if (lhk == rhk)
+        return CYStrictEquals(context, lhs, rhs, equal);
+
+    if (lhk == CYPrimitiveNull || rhk == CYPrimitiveNull) {
+        equal = false;
+        return true;
+    }
+
+    double lhn, rhn;
+    if (!CYToNumbers(context, lhs, rhs, lhn, rhn))
+        return false;
+    equal = lhn == rhn;
+    return true;
+}
+
+// sets order to -1, 0 or 1, or to 2 if either side is NaN
+static bool CYCompare(CYContext &context, CYExpression *lhs, CYExpression *rhs, int &order) {
+    CYString *lhstr(dynamic_cast<CYString *>(lhs->Primitive(context)));
+    CYString *rhstr(dynamic_cast<CYString *>(rhs->Primitive(context)));
+
+    if (lhstr != NULL && rhstr != NULL) {
+        // UTF-8 sorts as UTF-16 does until there are surrogate pairs
+        for (size_t i(0); i != lhstr->size_; ++i)
+            if ((lhstr->value_[i] & 0xf0) == 0xf0)
+                return false;
+        for (size_t i(0); i != rhstr->size_; ++i)
+            if ((rhstr->value_[i] & 0xf0) == 0xf0)
+                return false;
+
+        int value(memcmp(lhstr->value_, rhstr->value_, std::min(lhstr->size_, rhstr->size_)));
+        if (value == 0)
+            value = lhstr->size_ < rhstr->size_ ? -1 : lhstr->size_ > rhstr->size_ ? 1 : 0;
+        order = value < 0 ? -1 : value > 0 ? 1 : 0;
+        return true;
+    }
+
+    double lhn, rhn;
+    if (!CYToNumbers(context, lhs, rhs, lhn, rhn))
+        return false;
+    order = lhn < rhn ? -1 : lhn > rhn ? 1 : lhn == rhn ? 0 : 2;
+    return true;
+}
+
+static CYExpression *CYTruth(CYContext &context, bool value) {
+    if (value)
+        return $ CYTrue();
+    return $ CYFalse();
+}
+
+CYExpression *CYAdd::Primitive(CYContext &context) {
+    CYExpression *lhs(lhs_->Primitive(context));
+    if (lhs == NULL)
+        return NULL;
+    CYExpression *rhs(rhs_->Primitive(context));
+    if (rhs == NULL)
+        return NULL;
+
+    if (dynamic_cast<CYString *>(lhs) != NULL || dynamic_cast<CYString *>(rhs) != NULL) {
+        CYString *lhstr(lhs->String(context));
+        if (lhstr == NULL)
+            return NULL;
+        CYString *rhstr(rhs->String(context));
+        if (rhstr == NULL)
+            return NULL;
+        return lhstr->Concat(context, rhstr);
+    }
+
+    double lhn, rhn;
+    if (!CYToNumber(context, lhs, lhn) || !CYToNumber(context, rhs, rhn))
+        return NULL;
+    return $D(lhn + rhn);
+}
+
+CYExpression *CYAdd::Replace(CYContext &context) {
+    context.Replace(lhs_);
+    context.Replace(rhs_);
+    // this was folded long before the fold pass, so it still is at -O0
+    return CYFold(context, this);
 }
 
 CYExpression *CYAddressOf::Replace(CYContext &context) {
     return $C0($M(rhs_, $S("$cya")));
 }
 
+CYExpression *CYAffirm::Primitive(CYContext &context) {
+    double value;
+    if (!CYToNumber(context, rhs_->Primitive(context), value))
+        return NULL;
+    return $D(value);
+}
+
 CYTarget *CYApply::AddArgument(CYContext &context, CYExpression *value) {
     CYArgument **argument(&arguments_);
     while (*argument != NULL)
@@ -106,6 +401,17 @@ CYTarget *CYArray::Replace(CYContext &context) {
     return this;
 }
 
+// the body of the function Replace() makes, in a block that scopes the bindings instead
+CYStatement *CYArrayComprehension::Loop(CYContext &context, CYIdentifier *array) {
+    CYList<CYBindings> bindings;
+    CYForEach (parameter, comprehensions_->Parameters(context))
+        bindings->* $B1($B(parameter->binding_->identifier_));
+
+    return $ CYBlock($$
+        ->* (bindings ? $ CYLexical(false, bindings) : NULL)
+        ->* comprehensions_->Replace(context, $E($C1($M($V(array), $S("push")), expression_))));
+}
+
 CYTarget *CYArrayComprehension::Replace(CYContext &context) {
     CYIdentifier *cyv(context.Unique());
 
@@ -133,6 +439,34 @@ CYTarget *CYAttemptMember::Replace(CYContext &context) {
     ), object_);
 }
 
+CYExpression *CYBitwiseAnd::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(CYToInt32(lhs) & CYToInt32(rhs));
+}
+
+CYExpression *CYBitwiseNot::Primitive(CYContext &context) {
+    double value;
+    if (!CYToNumber(context, rhs_->Primitive(context), value))
+        return NULL;
+    return $D(~CYToInt32(value));
+}
+
+CYExpression *CYBitwiseOr::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(CYToInt32(lhs) | CYToInt32(rhs));
+}
+
+CYExpression *CYBitwiseXOr::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(CYToInt32(lhs) ^ CYToInt32(rhs));
+}
+
 CYStatement *CYBlock::Return() {
     CYImplicitReturn(code_);
     return this;
@@ -271,19 +605,110 @@ CYExpression *CYComputed::PropertyName(CYContext &context) {
     return expression_;
 }
 
+// calls, delete and typeof treat these differently from the value they hold
+static bool CYReference(CYExpression *value) {
+    while (CYParenthetical *parenthetical = dynamic_cast<CYParenthetical *>(value))
+        value = parenthetical->expression_;
+    return dynamic_cast<CYVariable *>(value) != NULL || dynamic_cast<CYMember *>(value) != NULL;
+}
+
 CYExpression *CYCondition::Replace(CYContext &context) {
     context.Replace(test_);
+
+    bool truth;
+    if (context.options_.Enabled(CYPassEliminate) && CYConstant(test_) && CYToBoolean(context, test_, truth)) {
+        CYExpression *value(truth ? true_ : false_);
+        if (CYReference(value))
+            return $ CYCompound($D(0), value);
+        return value;
+    }
+
     context.Replace(true_);
     context.Replace(false_);
     return this;
 }
 
+bool CYContext::Abrupt(CYStatement *statement) const {
+    if (statement == NULL || !options_.Enabled(CYPassEliminate))
+        return false;
+    return dynamic_cast<CYReturn *>(statement) != NULL
+        || dynamic_cast<cy::Syntax::Throw *>(statement) != NULL
+        || dynamic_cast<CYBreak *>(statement) != NULL
+        || dynamic_cast<CYContinue *>(statement) != NULL;
+}
+
+// declarations in code that never runs still hoist: statements with functions in them are kept, and var names are seen by CYScope::Close
+void CYContext::Eliminate(CYStatement *&statements) {
+    CYPassTimer timer(options_, CYPassEliminate);
+    CYList<CYStatement> hoisted;
+
+    ++dead_;
+    for (CYStatement *next(statements); next != NULL; ) {
+        CYStatement *statement(next);
+        next = statement->next_;
+
+        unsigned functions(functions_);
+        Replace(statement);
+        if (statement != NULL && functions != functions_) {
+            statement->SetNext(NULL);
+            hoisted->* statement;
+        }
+    }
+    --dead_;
+
+    statements = hoisted;
+}
+
+// a comprehension evaluated before anything else in its statement can run as a loop ahead of it
+void CYContext::Inline(CYStatement *&statement) {
+    CYContext &context(*this);
+
+    // with eval around, even within the comprehension, the block's let would not be renamed and would clobber a var
+    if (!options_.Enabled(CYPassInline) || eval_ || scope_->damaged_)
+        return;
+    CYPassTimer timer(options_, CYPassInline);
+
+    CYExpression **value(NULL);
+    if (CYExpress *express = dynamic_cast<CYExpress *>(statement)) {
+        if (CYAssign *assign = dynamic_cast<CYAssign *>(express->expression_)) {
+            if (dynamic_cast<CYVariable *>(assign->lhs_) != NULL)
+                value = &assign->rhs_;
+        } else
+            value = &express->expression_;
+    } else if (CYVar *var = dynamic_cast<CYVar *>(statement))
+        value = &var->bindings_->binding_->initializer_;
+    else if (CYLexical *lexical = dynamic_cast<CYLexical *>(statement))
+        value = &lexical->bindings_->binding_->initializer_;
+    else if (CYReturn *_return = dynamic_cast<CYReturn *>(statement))
+        value = &_return->value_;
+
+    CYArrayComprehension *comprehension(value == NULL ? NULL : dynamic_cast<CYArrayComprehension *>(*value));
+    if (comprehension == NULL)
+        return;
+
+    CYIdentifier *array(Unique());
+    *value = $V(array);
+
+    statement = $$
+        ->* $ CYVar($B1($B(array, $ CYArray())))
+        ->* comprehension->Loop(context, array)
+        ->* statement;
+}
+
+// the body of an if or a loop without braces has to stay a single statement
+void CYContext::ReplaceOne(CYStatement *&statement) {
+    ReplaceAll(statement);
+    if (statement != NULL && statement->next_ != NULL)
+        statement = $ CYBlock(statement);
+}
+
 void CYContext::NonLocal(CYStatement *&statements) {
     CYContext &context(*this);
 
     if (nextlocal_ != NULL && nextlocal_->identifier_ != NULL) {
         CYIdentifier *cye($I("$cye")->Replace(context, CYIdentifierGlobal));
         CYIdentifier *unique(nextlocal_->identifier_->Replace(context, CYIdentifierGlobal));
+        scope_->Declare(context, unique, CYIdentifierVariable);
 
         CYStatement *declare(
             $ CYVar($B1($B(unique, $ CYObject()))));
@@ -356,9 +781,16 @@ CYTarget *CYDirectMember::Replace(CYContext &context) {
     return this;
 }
 
+CYExpression *CYDivide::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(lhs / rhs);
+}
+
 CYStatement *CYDoWhile::Replace(CYContext &context) {
     context.Replace(test_);
-    context.ReplaceAll(code_);
+    context.ReplaceOne(code_);
     return this;
 }
 
@@ -370,6 +802,13 @@ void CYElementValue::Replace(CYContext &context) {
     context.Replace(value_);
 }
 
+CYExpression *CYEqual::Primitive(CYContext &context) {
+    bool equal;
+    if (!CYLooseEquals(context, lhs_, rhs_, equal))
+        return NULL;
+    return CYTruth(context, equal);
+}
+
 CYForInitializer *CYEmpty::Replace(CYContext &context) {
     return NULL;
 }
@@ -390,7 +829,11 @@ CYStatement *CYExpress::Return() {
 }
 
 CYForInitializer *CYExpress::Replace(CYContext &context) {
+    bool directive(dynamic_cast<CYString *>(expression_) != NULL);
     context.Replace(expression_);
+    // a template or sum folded to a string must not become a directive
+    if (!directive && dynamic_cast<CYString *>(expression_) != NULL)
+        expression_ = $ CYParenthetical(expression_);
     return this;
 }
 
@@ -445,7 +888,7 @@ CYStatement *CYFor::Replace(CYContext &context) {
 
     {
         CYScope inner(true, context);
-        context.ReplaceAll(code_);
+        context.ReplaceOne(code_);
         inner.Close(context);
     }
 
@@ -474,7 +917,7 @@ CYStatement *CYForIn::Replace(CYContext &context) {
     CYScope scope(true, context);
     context.Replace(initializer_);
     context.Replace(iterable_);
-    context.ReplaceAll(code_);
+    context.ReplaceOne(code_);
     scope.Close(context);
     return this;
 }
@@ -558,6 +1001,7 @@ void CYFunction::Replace(CYContext &context) {
     } else {
         localize = true;
         nonlocal_ = $ CYNonLocal();
+        context.nonlocal_ = NULL;
         context.nextlocal_ = nonlocal_;
     }
 
@@ -614,11 +1058,33 @@ void CYFunctionParameter::Replace(CYContext &context, CYStatement *&statements)
 }
 
 CYStatement *CYFunctionStatement::Replace(CYContext &context) {
+    ++context.functions_;
     name_ = name_->Replace(context, CYIdentifierOther);
     CYFunction::Replace(context);
     return this;
 }
 
+CYExpression *CYGreater::Primitive(CYContext &context) {
+    int order;
+    if (!CYCompare(context, lhs_, rhs_, order))
+        return NULL;
+    return CYTruth(context, order == 1);
+}
+
+CYExpression *CYGreaterOrEqual::Primitive(CYContext &context) {
+    int order;
+    if (!CYCompare(context, lhs_, rhs_, order))
+        return NULL;
+    return CYTruth(context, order == 1 || order == 0);
+}
+
+CYExpression *CYIdentical::Primitive(CYContext &context) {
+    bool equal;
+    if (!CYStrictEquals(context, lhs_, rhs_, equal))
+        return NULL;
+    return CYTruth(context, equal);
+}
+
 CYIdentifier *CYIdentifier::Replace(CYContext &context, CYIdentifierKind kind) {
     if (next_ == this)
         return this;
@@ -636,8 +1102,27 @@ CYStatement *CYIf::Return() {
 
 CYStatement *CYIf::Replace(CYContext &context) {
     context.Replace(test_);
-    context.ReplaceAll(true_);
-    context.ReplaceAll(false_);
+
+    bool truth;
+    if (context.options_.Enabled(CYPassEliminate) && CYConstant(test_) && CYToBoolean(context, test_, truth)) {
+        CYStatement *&live(truth ? true_ : false_);
+        CYStatement *&dead(truth ? false_ : true_);
+
+        context.Eliminate(dead);
+        if (dead != NULL) {
+            context.ReplaceOne(live);
+            return this;
+        }
+
+        if (live == NULL)
+            return $ CYEmpty();
+        if (live->next_ == NULL)
+            return live;
+        return $ CYBlock(live);
+    }
+
+    context.ReplaceOne(true_);
+    context.ReplaceOne(false_);
     return this;
 }
 
@@ -685,7 +1170,10 @@ CYTarget *CYIndirectMember::Replace(CYContext &context) {
 CYExpression *CYInfix::Replace(CYContext &context) {
     context.Replace(lhs_);
     context.Replace(rhs_);
-    return this;
+    if (!context.options_.Enabled(CYPassFold))
+        return this;
+    CYPassTimer timer(context.options_, CYPassFold);
+    return CYFold(context, this);
 }
 
 CYStatement *CYLabel::Replace(CYContext &context) {
@@ -693,6 +1181,20 @@ CYStatement *CYLabel::Replace(CYContext &context) {
     return this;
 }
 
+CYExpression *CYLess::Primitive(CYContext &context) {
+    int order;
+    if (!CYCompare(context, lhs_, rhs_, order))
+        return NULL;
+    return CYTruth(context, order == -1);
+}
+
+CYExpression *CYLessOrEqual::Primitive(CYContext &context) {
+    int order;
+    if (!CYCompare(context, lhs_, rhs_, order))
+        return NULL;
+    return CYTruth(context, order == -1 || order == 0);
+}
+
 CYTarget *CYLambda::Replace(CYContext &context) {
     return $N2($V("Functor"), $ CYFunctionExpression(NULL, parameters_->Parameters(context), code_), parameters_->TypeSignature(context, typed_->Replace(context)));
 }
@@ -711,20 +1213,47 @@ void CYMethod::Replace(CYContext &context) {
     CYFunction::Replace(context);
 }
 
+CYExpression *CYModulus::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(std::fmod(lhs, rhs));
+}
+
 CYString *CYModule::Replace(CYContext &context, const char *separator) const {
     if (next_ == NULL)
         return $ CYString(part_);
     return $ CYString($pool.strcat(next_->Replace(context, separator)->Value(), separator, part_->Word(), NULL));
 }
 
+CYExpression *CYMultiply::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(lhs * rhs);
+}
+
 CYExpression *CYMultiply::Replace(CYContext &context) {
-    CYInfix::Replace(context);
+    context.Replace(lhs_);
+    context.Replace(rhs_);
+    // like CYAdd, this does not wait for the fold pass
+    return CYFold(context, this);
+}
 
-    if (CYNumber *lhn = lhs_->Number(context))
-        if (CYNumber *rhn = rhs_->Number(context))
-            return $D(lhn->Value() * rhn->Value());
+CYExpression *CYNegate::Primitive(CYContext &context) {
+    double value;
+    if (!CYToNumber(context, rhs_->Primitive(context), value))
+        return NULL;
+    return $D(-value);
+}
 
-    return this;
+CYExpression *CYNegate::Replace(CYContext &context) {
+    context.Replace(rhs_);
+    // this is how a negative number is written, and folding it would make it again
+    if (dynamic_cast<CYNumber *>(rhs_) != NULL || !context.options_.Enabled(CYPassFold))
+        return this;
+    CYPassTimer timer(context.options_, CYPassFold);
+    return CYFold(context, this);
 }
 
 namespace cy {
@@ -743,6 +1272,20 @@ CYTarget *New::Replace(CYContext &context) {
 
 } }
 
+CYExpression *CYNotEqual::Primitive(CYContext &context) {
+    bool equal;
+    if (!CYLooseEquals(context, lhs_, rhs_, equal))
+        return NULL;
+    return CYTruth(context, !equal);
+}
+
+CYExpression *CYNotIdentical::Primitive(CYContext &context) {
+    bool equal;
+    if (!CYStrictEquals(context, lhs_, rhs_, equal))
+        return NULL;
+    return CYTruth(context, !equal);
+}
+
 CYNumber *CYNull::Number(CYContext &context) {
     return $D(0);
 }
@@ -756,8 +1299,9 @@ CYNumber *CYNumber::Number(CYContext &context) {
 }
 
 CYString *CYNumber::String(CYContext &context) {
-    // XXX: there is a precise algorithm for this
-    return $S($pool.sprintf(24, "%.17g", Value()));
+    std::ostringstream str;
+    CYNumerify(str, Value());
+    return $S($pool.strdup(str.str().c_str()));
 }
 
 CYExpression *CYNumber::PropertyName(CYContext &context) {
@@ -785,9 +1329,17 @@ CYTarget *CYObject::Replace(CYContext &context) {
     return Replace(context, this);
 }
 
+CYExpression *CYParenthetical::Primitive(CYContext &context) {
+    return expression_->Primitive(context);
+}
+
 CYTarget *CYParenthetical::Replace(CYContext &context) {
     // XXX: return expression_;
     context.Replace(expression_);
+    // a string could turn an expression statement into a directive
+    if (context.options_.Enabled(CYPassFold))
+        if (dynamic_cast<CYNumber *>(expression_) != NULL || dynamic_cast<CYBoolean *>(expression_) != NULL || dynamic_cast<CYNull *>(expression_) != NULL)
+            return static_cast<CYTrivial *>(expression_);
     return this;
 }
 
@@ -798,7 +1350,10 @@ CYExpression *CYPostfix::Replace(CYContext &context) {
 
 CYExpression *CYPrefix::Replace(CYContext &context) {
     context.Replace(rhs_);
-    return this;
+    if (!context.options_.Enabled(CYPassFold))
+        return this;
+    CYPassTimer timer(context.options_, CYPassFold);
+    return CYFold(context, this);
 }
 
 CYProperty *CYProperty::ReplaceAll(CYContext &context, CYBuilder &builder, CYExpression *self, bool update) {
@@ -876,11 +1431,19 @@ void CYScript::Replace(CYContext &context) {
     CYScope scope(false, context);
     context.scope_->Damage();
 
-    context.nextlocal_ = $ CYNonLocal();
-    context.ReplaceAll(code_);
-    context.NonLocal(code_);
+    {
+        CYPassTimer timer(context.options_, CYPassLower);
 
-    scope.Close(context, code_);
+        context.nextlocal_ = $ CYNonLocal();
+        context.ReplaceAll(code_);
+        context.NonLocal(code_);
+
+        scope.Close(context, code_);
+    }
+
+    if (!context.options_.Enabled(CYPassRename))
+        return;
+    CYPassTimer timer(context.options_, CYPassRename);
 
     unsigned offset(0);
 
@@ -950,7 +1513,10 @@ CYScope::CYScope(bool transparent, CYContext &context) :
     parent_(context.scope_),
     damaged_(false),
     shadow_(NULL),
-    internal_(NULL)
+    internal_(NULL),
+    count_(0),
+    index_(NULL),
+    mask_(0)
 {
     _assert(!transparent_ || parent_ != NULL);
     context.scope_ = this;
@@ -962,11 +1528,35 @@ void CYScope::Damage() {
         parent_->Damage();
 }
 
+static _finline size_t CYScopeHash(const char *atom) {
+    return (reinterpret_cast<uintptr_t>(atom) >> 3) * 2654435761u;
+}
+
+void CYScope::Index(CYIdentifierFlags *flags) {
+    size_t index(CYScopeHash(flags->atom_) & mask_);
+    while (index_[index] != NULL)
+        index = (index + 1) & mask_;
+    index_[index] = flags;
+}
+
+CYIdentifierFlags *CYScope::Find(const char *atom) {
+    if (index_ == NULL) {
+        CYForEach (i, internal_)
+            if (i->atom_ == atom)
+                return i;
+        return NULL;
+    }
+
+    for (size_t index(CYScopeHash(atom) & mask_); ; index = (index + 1) & mask_)
+        if (index_[index] == NULL || index_[index]->atom_ == atom)
+            return index_[index];
+}
+
 CYIdentifierFlags *CYScope::Lookup(CYContext &context, const char *word) {
-    CYForEach (i, internal_)
-        if (strcmp(i->identifier_->Word(), word) == 0)
-            return i;
-    return NULL;
+    const char *atom(context.atoms_.Find(word));
+    if (atom == NULL)
+        return NULL;
+    return Find(atom);
 }
 
 CYIdentifierFlags *CYScope::Lookup(CYContext &context, CYIdentifier *identifier) {
@@ -974,14 +1564,33 @@ CYIdentifierFlags *CYScope::Lookup(CYContext &context, CYIdentifier *identifier)
 }
 
 CYIdentifierFlags *CYScope::Declare(CYContext &context, CYIdentifier *identifier, CYIdentifierKind kind) {
+    return Declare(context, identifier, context.atoms_.Intern(identifier->Word()), kind);
+}
+
+CYIdentifierFlags *CYScope::Declare(CYContext &context, CYIdentifier *identifier, const char *atom, CYIdentifierKind kind) {
     _assert(identifier->next_ == NULL || identifier->next_ == identifier);
 
-    CYIdentifierFlags *existing(Lookup(context, identifier));
-    if (existing == NULL)
-        internal_ = $ CYIdentifierFlags(identifier, kind, internal_);
+    CYIdentifierFlags *existing(Find(atom));
+    if (existing == NULL) {
+        internal_ = $ CYIdentifierFlags(identifier, atom, kind, internal_);
+
+        if (++count_ * 2 > mask_ + 1 && count_ > 8) {
+            mask_ = mask_ == 0 ? 31 : mask_ * 2 + 1;
+            index_ = $pool.calloc<CYIdentifierFlags *>(mask_ + 1, sizeof(CYIdentifierFlags *));
+            CYForEach (i, internal_)
+                Index(i);
+        } else if (index_ != NULL)
+            Index(internal_);
+    }
     ++internal_->count_;
-    if (existing == NULL)
+    if (existing == NULL) {
+        if (context.dead_ == 0)
+            internal_->live_ = true;
         return internal_;
+    }
+
+    if (context.dead_ == 0)
+        existing->live_ = true;
 
     if (kind == CYIdentifierGlobal);
     else if (existing->kind_ == CYIdentifierGlobal || existing->kind_ == CYIdentifierMagic)
@@ -997,7 +1606,7 @@ CYIdentifierFlags *CYScope::Declare(CYContext &context, CYIdentifier *identifier
 
 void CYScope::Merge(CYContext &context, const CYIdentifierFlags *flags) {
     _assert(flags->identifier_->next_ == flags->identifier_);
-    CYIdentifierFlags *existing(Declare(context, flags->identifier_, flags->kind_));
+    CYIdentifierFlags *existing(Declare(context, flags->identifier_, flags->atom_, flags->kind_));
     flags->identifier_->next_ = existing->identifier_;
 
     existing->count_ += flags->count_;
@@ -1008,10 +1617,12 @@ void CYScope::Merge(CYContext &context, const CYIdentifierFlags *flags) {
 void CYScope::Close(CYContext &context, CYStatement *&statements) {
     Close(context);
 
+    bool eliminate(!damaged_ && parent_ != NULL && context.options_.Enabled(CYPassEliminate));
+
     CYList<CYBindings> bindings;
 
     CYForEach (i, internal_)
-        if (i->kind_ == CYIdentifierVariable)
+        if (i->kind_ == CYIdentifierVariable && (i->live_ || !eliminate))
             bindings
                 ->* $ CYBindings($ CYBinding(i->identifier_));
 
@@ -1022,6 +1633,16 @@ void CYScope::Close(CYContext &context, CYStatement *&statements) {
     }
 }
 
+struct CYIdentifierOffset {
+    unsigned offset_;
+    size_t sequence_;
+    CYIdentifier *identifier_;
+
+    bool operator <(const CYIdentifierOffset &rhs) const {
+        return offset_ < rhs.offset_ || offset_ == rhs.offset_ && sequence_ < rhs.sequence_;
+    }
+};
+
 void CYScope::Close(CYContext &context) {
     context.scope_ = parent_;
 
@@ -1034,17 +1655,18 @@ void CYScope::Close(CYContext &context) {
                 replace->next_ = replace;
                 i->identifier_->next_ = replace;
                 i->identifier_ = replace;
+                i->atom_ = context.atoms_.Intern(replace->Word());
             }
 
             if (!transparent_)
                 i->kind_ = CYIdentifierVariable;
             else
-                parent_->Declare(context, i->identifier_, CYIdentifierVariable);
+                parent_->Declare(context, i->identifier_, i->atom_, CYIdentifierVariable);
         } break;
 
         case CYIdentifierVariable: {
             if (transparent_) {
-                parent_->Declare(context, i->identifier_, i->kind_);
+                parent_->Declare(context, i->identifier_, i->atom_, i->kind_);
                 i->kind_ = CYIdentifierGlobal;
             }
         } break;
@@ -1053,34 +1675,43 @@ void CYScope::Close(CYContext &context) {
     if (damaged_)
         return;
 
-    typedef std::multimap<unsigned, CYIdentifier *> CYIdentifierOffsetMap;
-    CYIdentifierOffsetMap offsets;
-
-    CYForEach (i, internal_) {
-        _assert(i->identifier_->next_ == i->identifier_);
-    switch (i->kind_) {
-        case CYIdentifierArgument:
-        case CYIdentifierVariable:
-            offsets.insert(CYIdentifierOffsetMap::value_type(i->offset_, i->identifier_));
-        break;
-    default:; } }
-
     unsigned offset(0);
 
-    for (CYIdentifierOffsetMap::const_iterator i(offsets.begin()); i != offsets.end(); ++i) {
-        if (offset < i->first)
-            offset = i->first;
-        CYIdentifier *identifier(i->second);
-
-        if (offset >= context.replace_.size())
-            context.replace_.resize(offset + 1, NULL);
-        CYIdentifier *&replace(context.replace_[offset++]);
-
-        if (replace == NULL)
-            replace = identifier;
-        else {
-            _assert(replace->next_ == replace);
-            identifier->next_ = replace;
+    // without renaming, nothing is collected for it and nothing needs to be avoided; globals are still merged up below
+    if (context.options_.Enabled(CYPassRename)) {
+        // ordered by offset, then by position in internal_, as a multimap would
+        CYIdentifierOffset *offsets($pool.malloc<CYIdentifierOffset>(sizeof(CYIdentifierOffset) * count_));
+        size_t size(0);
+
+        CYForEach (i, internal_) {
+            _assert(i->identifier_->next_ == i->identifier_);
+        switch (i->kind_) {
+            case CYIdentifierArgument:
+            case CYIdentifierVariable: {
+                CYIdentifierOffset &entry(offsets[size]);
+                entry.offset_ = i->offset_;
+                entry.sequence_ = size++;
+                entry.identifier_ = i->identifier_;
+            } break;
+        default:; } }
+
+        std::sort(offsets, offsets + size);
+
+        for (size_t i(0); i != size; ++i) {
+            if (offset < offsets[i].offset_)
+                offset = offsets[i].offset_;
+            CYIdentifier *identifier(offsets[i].identifier_);
+
+            if (offset >= context.replace_.size())
+                context.replace_.resize(offset + 1, NULL);
+            CYIdentifier *&replace(context.replace_[offset++]);
+
+            if (replace == NULL)
+                replace = identifier;
+            else {
+                _assert(replace->next_ == replace);
+                identifier->next_ = replace;
+            }
         }
     }
 
@@ -1097,6 +1728,27 @@ void CYScope::Close(CYContext &context) {
     default:; } }
 }
 
+CYExpression *CYShiftLeft::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(int32_t(CYToUint32(lhs) << (CYToUint32(rhs) & 0x1f)));
+}
+
+CYExpression *CYShiftRightSigned::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(CYToInt32(lhs) >> (CYToUint32(rhs) & 0x1f));
+}
+
+CYExpression *CYShiftRightUnsigned::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(CYToUint32(lhs) >> (CYToUint32(rhs) & 0x1f));
+}
+
 CYTarget *CYSubscriptMember::Replace(CYContext &context) {
     return $C1($M(object_, $S("$cyg")), property_);
 }
@@ -1162,6 +1814,13 @@ CYTarget *CYStructTail::Replace(CYContext &context) {
     return $N2($V("Type"), $ CYArray(types), $ CYArray(names));
 }
 
+CYExpression *CYSubtract::Primitive(CYContext &context) {
+    double lhs, rhs;
+    if (!CYToNumbers(context, lhs_, rhs_, lhs, rhs))
+        return NULL;
+    return $D(lhs - rhs);
+}
+
 CYTarget *CYSuperAccess::Replace(CYContext &context) {
     return $C1($M($M($M($V(context.super_), $S("prototype")), property_), $S("bind")), $ CYThis());
 }
@@ -1186,15 +1845,75 @@ CYStatement *CYTarget::Initialize(CYContext &context, CYExpression *value) {
     return $E($ CYAssign(this, value));
 }
 
+// ToPrimitive leaves these as they are, so + converts them to strings just as a template would
+static bool CYPrimitiveResult(CYExpression *value) {
+    if (dynamic_cast<CYLogicalAnd *>(value) != NULL || dynamic_cast<CYLogicalOr *>(value) != NULL || dynamic_cast<CYAddressOf *>(value) != NULL)
+        return false;
+    if (dynamic_cast<CYInfix *>(value) != NULL || dynamic_cast<CYPrefix *>(value) != NULL || dynamic_cast<CYPostfix *>(value) != NULL)
+        return true;
+    if (dynamic_cast<CYTemplate *>(value) != NULL)
+        return true;
+    return CYKind(value) != CYPrimitiveOther;
+}
+
+CYExpression *CYTemplate::Primitive(CYContext &context) {
+    return String(context);
+}
+
 CYTarget *CYTemplate::Replace(CYContext &context) {
+    if (context.options_.Enabled(CYPassFold)) {
+        CYPassTimer timer(context.options_, CYPassFold);
+
+        // spans with constant values merge into the strings around them
+        CYString **string(&string_);
+        CYSpan **next(&spans_);
+        while (CYSpan *span = *next) {
+            CYExpression *value(span->expression_->Primitive(context));
+            if (CYString *text = value == NULL ? NULL : value->String(context)) {
+                *string = (*string)->Concat(context, text)->Concat(context, span->string_);
+                *next = span->next_;
+            } else {
+                string = &span->string_;
+                next = &span->next_;
+            }
+        }
+
+        if (spans_ == NULL)
+            return string_;
+    }
+
+    if (context.options_.Enabled(CYPassInline)) {
+        CYPassTimer timer(context.options_, CYPassInline);
+
+        CYExpression *value(string_->size_ == 0 ? NULL : string_);
+        CYForEach (span, spans_) {
+            CYExpression *expression(span->expression_);
+            if (value == NULL || !CYPrimitiveResult(expression))
+                expression = $C1($V("String"), expression);
+            value = value == NULL ? expression : $ CYAdd(value, expression);
+            if (span->string_->size_ != 0)
+                value = $ CYAdd(value, span->string_);
+        }
+
+        // a CYTarget is needed here, and a parenthetical is one
+        return $ CYParenthetical(value);
+    }
+
     return $C2($M($M($M($V("String"), $S("prototype")), $S("concat")), $S("apply")), $S(""), $ CYArray($ CYElementValue(string_, spans_->Replace(context))));
 }
 
 CYString *CYTemplate::String(CYContext &context) {
-    // XXX: implement this over local concat
-    if (spans_ != NULL)
-        return NULL;
-    return string_;
+    CYString *string(string_);
+    CYForEach (span, spans_) {
+        CYExpression *value(span->expression_->Primitive(context));
+        if (value == NULL)
+            return NULL;
+        CYString *text(value->String(context));
+        if (text == NULL)
+            return NULL;
+        string = string->Concat(context, text)->Concat(context, span->string_);
+    }
+    return string;
 }
 
 CYTarget *CYThis::Replace(CYContext &context) {
@@ -1401,7 +2120,7 @@ CYFunctionParameter *CYVariable::Parameter() const {
 
 CYStatement *CYWhile::Replace(CYContext &context) {
     context.Replace(test_);
-    context.ReplaceAll(code_);
+    context.ReplaceOne(code_);
     return this;
 }
 
@@ -1409,7 +2128,7 @@ CYStatement *CYWith::Replace(CYContext &context) {
     context.Replace(scope_);
     CYScope scope(true, context);
     scope.Damage();
-    context.ReplaceAll(code_);
+    context.ReplaceOne(code_);
     scope.Close(context);
     return this;
 }
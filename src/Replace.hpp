@@ -22,6 +22,8 @@
 #ifndef CYCRIPT_REPLACE_HPP
 #define CYCRIPT_REPLACE_HPP
 
+#include <chrono>
+
 #include "Syntax.hpp"
 
 #define $ new($pool)
@@ -228,4 +230,34 @@
 
 #endif
 
+// adds the time until it is destroyed to the pass, if the options are collecting times
+// passes run within one another, so a timer pauses the one around it rather than being counted twice
+class CYPassTimer {
+  private:
+    CYOptions &options_;
+    CYPass outer_;
+
+    void Switch(CYPass pass) {
+        uint64_t now(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        if (options_.timing_ != CYPassCount)
+            options_.times_[options_.timing_] += now - options_.mark_;
+        options_.timing_ = pass;
+        options_.mark_ = now;
+    }
+
+  public:
+    CYPassTimer(CYOptions &options, CYPass pass) :
+        options_(options),
+        outer_(options.timing_)
+    {
+        if (options_.times_ != NULL)
+            Switch(pass);
+    }
+
+    ~CYPassTimer() {
+        if (options_.times_ != NULL)
+            Switch(outer_);
+    }
+};
+
 #endif/*CYCRIPT_REPLACE_HPP*/
@@ -0,0 +1,50 @@
+/* Cycript - The Truly Universal Scripting Language
+ * Copyright (C) 2009-2016  Jay Freeman (saurik)
+*/
+
+/* GNU Affero General Public License, Version 3 {{{ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/* }}} */
+
+#ifndef CYCRIPT_SCANNER_HPP
+#define CYCRIPT_SCANNER_HPP
+
+#include "Driver.hpp"
+#include "Highlight.hpp"
+#include "Location.hpp"
+
+struct YYSTYPE;
+
+// both are generated from Scanner.lpp.in; the ASCII one lacks the Unicode identifier
+// and line terminator classes, and so must only ever be handed 7-bit input
+struct CYScanner {
+    int (*lex_)(YYSTYPE *, CYLocation *, void *);
+    bool (*highlight_)(hi::Value &, CYLocation &, void *);
+
+    void (*init_)(CYDriver &);
+    void (*reset_)(CYDriver &);
+    void (*destroy_)(CYDriver &);
+
+    void (*regex_)(CYDriver &, bool);
+    void (*condition_)(CYDriver &, CYDriver::Condition);
+    void (*push_)(CYDriver &, CYDriver::Condition);
+    void (*pop_)(CYDriver &);
+};
+
+extern const CYScanner CYScannerUnicode;
+extern const CYScanner CYScannerASCII;
+
+#endif/*CYCRIPT_SCANNER_HPP*/
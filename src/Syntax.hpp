@@ -29,6 +29,7 @@
 #include <string>
 #include <vector>
 
+#include "Atom.hpp"
 #include "List.hpp"
 #include "Location.hpp"
 #include "Options.hpp"
@@ -283,14 +284,8 @@ struct CYIdentifier :
     CYNext<CYIdentifier>,
     CYWord
 {
-    CYLocation location_;
-    size_t offset_;
-    size_t usage_;
-
     CYIdentifier(const char *word) :
-        CYWord(word),
-        offset_(0),
-        usage_(0)
+        CYWord(word)
     {
     }
 
@@ -340,16 +335,21 @@ struct CYIdentifierFlags :
     CYNext<CYIdentifierFlags>
 {
     CYIdentifier *identifier_;
+    const char *atom_;
     CYIdentifierKind kind_;
     unsigned count_;
     unsigned offset_;
+    // seen outside of code that was eliminated
+    bool live_;
 
-    CYIdentifierFlags(CYIdentifier *identifier, CYIdentifierKind kind, CYIdentifierFlags *next = NULL) :
+    CYIdentifierFlags(CYIdentifier *identifier, const char *atom, CYIdentifierKind kind, CYIdentifierFlags *next = NULL) :
         CYNext<CYIdentifierFlags>(next),
         identifier_(identifier),
+        atom_(atom),
         kind_(kind),
         count_(0),
-        offset_(0)
+        offset_(0),
+        live_(false)
     {
     }
 };
@@ -361,12 +361,22 @@ struct CYScope {
     CYIdentifierFlags *shadow_;
 
     CYIdentifierFlags *internal_;
+    size_t count_;
+
+    // built once a scope outgrows a short linear walk; keyed by atom pointer
+    CYIdentifierFlags **index_;
+    size_t mask_;
 
     CYScope(bool transparent, CYContext &context);
 
+    void Index(CYIdentifierFlags *flags);
+
+    CYIdentifierFlags *Find(const char *atom);
+
     CYIdentifierFlags *Lookup(CYContext &context, const char *word);
     CYIdentifierFlags *Lookup(CYContext &context, CYIdentifier *identifier);
 
+    CYIdentifierFlags *Declare(CYContext &context, CYIdentifier *identifier, const char *atom, CYIdentifierKind kind);
     CYIdentifierFlags *Declare(CYContext &context, CYIdentifier *identifier, CYIdentifierKind kind);
     void Merge(CYContext &context, const CYIdentifierFlags *flags);
 
@@ -401,8 +411,15 @@ struct CYContext {
 
     CYNonLocal *nonlocal_;
     CYNonLocal *nextlocal_;
+    // whether the code might use a direct eval, which only shows once it has been replaced
+    bool eval_;
     unsigned unique_;
 
+    // code replaced while dead_ is set is then thrown away; functions_ counts hoisted declarations
+    unsigned dead_;
+    unsigned functions_;
+
+    CYAtoms atoms_;
     std::vector<CYIdentifier *> replace_;
 
     CYContext(CYOptions &options) :
@@ -412,17 +429,25 @@ struct CYContext {
         super_(NULL),
         nonlocal_(NULL),
         nextlocal_(NULL),
-        unique_(0)
+        eval_(true),
+        unique_(0),
+        dead_(0),
+        functions_(0),
+        atoms_($pool)
     {
     }
 
     void ReplaceAll(CYStatement *&statement) {
         if (statement == NULL)
             return;
+        Inline(statement);
         CYStatement *next(statement->next_);
 
         Replace(statement);
-        ReplaceAll(next);
+        if (Abrupt(statement))
+            Eliminate(next);
+        else
+            ReplaceAll(next);
 
         if (statement == NULL)
             statement = next;
@@ -442,6 +467,11 @@ struct CYContext {
         }
     }
 
+    bool Abrupt(CYStatement *statement) const;
+    void Eliminate(CYStatement *&statements);
+    void Inline(CYStatement *&statement);
+    void ReplaceOne(CYStatement *&statement);
+
     void NonLocal(CYStatement *&statements);
     CYIdentifier *Unique();
 };
@@ -617,6 +647,8 @@ struct CYParenthetical :
 
     CYPrecedence(0)
 
+    virtual CYExpression *Primitive(CYContext &context);
+
     virtual CYTarget *Replace(CYContext &context);
     void Output(CYOutput &out, CYFlags flags) const;
 };
@@ -720,6 +752,8 @@ struct CYArrayComprehension :
 
     CYPrecedence(0)
 
+    CYStatement *Loop(CYContext &context, CYIdentifier *array);
+
     virtual CYTarget *Replace(CYContext &context);
     virtual void Output(CYOutput &out, CYFlags flags) const;
 };
@@ -727,8 +761,6 @@ struct CYArrayComprehension :
 struct CYLiteral :
     CYTarget
 {
-    CYLocation location_;
-
     CYPrecedence(0)
 
     virtual CYExpression *Primitive(CYContext &context) {
@@ -852,6 +884,7 @@ struct CYTemplate :
 
     CYPrecedence(0)
 
+    virtual CYExpression *Primitive(CYContext &context);
     virtual CYString *String(CYContext &context);
 
     virtual CYTarget *Replace(CYContext &context);
@@ -2868,6 +2901,9 @@ struct CYIndirect :
 #define CYReplace \
     virtual CYExpression *Replace(CYContext &context);
 
+#define CYPrimitive \
+    virtual CYExpression *Primitive(CYContext &context);
+
 #define CYPostfix_(op, name, ...) \
     struct CY ## name : \
         CYPostfix \
@@ -2937,32 +2973,32 @@ CYPrefix_(true, "void", Void)
 CYPrefix_(true, "typeof", TypeOf)
 CYPrefix_(false, "++", PreIncrement)
 CYPrefix_(false, "--", PreDecrement)
-CYPrefix_(false, "+", Affirm)
-CYPrefix_(false, "-", Negate)
-CYPrefix_(false, "~", BitwiseNot)
+CYPrefix_(false, "+", Affirm, CYPrimitive)
+CYPrefix_(false, "-", Negate, CYPrimitive CYReplace)
+CYPrefix_(false, "~", BitwiseNot, CYPrimitive)
 CYPrefix_(false, "!", LogicalNot)
 
-CYInfix_(false, 5, "*", Multiply, CYReplace)
-CYInfix_(false, 5, "/", Divide)
-CYInfix_(false, 5, "%", Modulus)
-CYInfix_(false, 6, "+", Add, CYReplace)
-CYInfix_(false, 6, "-", Subtract)
-CYInfix_(false, 7, "<<", ShiftLeft)
-CYInfix_(false, 7, ">>", ShiftRightSigned)
-CYInfix_(false, 7, ">>>", ShiftRightUnsigned)
-CYInfix_(false, 8, "<", Less)
-CYInfix_(false, 8, ">", Greater)
-CYInfix_(false, 8, "<=", LessOrEqual)
-CYInfix_(false, 8, ">=", GreaterOrEqual)
+CYInfix_(false, 5, "*", Multiply, CYPrimitive CYReplace)
+CYInfix_(false, 5, "/", Divide, CYPrimitive)
+CYInfix_(false, 5, "%", Modulus, CYPrimitive)
+CYInfix_(false, 6, "+", Add, CYPrimitive CYReplace)
+CYInfix_(false, 6, "-", Subtract, CYPrimitive)
+CYInfix_(false, 7, "<<", ShiftLeft, CYPrimitive)
+CYInfix_(false, 7, ">>", ShiftRightSigned, CYPrimitive)
+CYInfix_(false, 7, ">>>", ShiftRightUnsigned, CYPrimitive)
+CYInfix_(false, 8, "<", Less, CYPrimitive)
+CYInfix_(false, 8, ">", Greater, CYPrimitive)
+CYInfix_(false, 8, "<=", LessOrEqual, CYPrimitive)
+CYInfix_(false, 8, ">=", GreaterOrEqual, CYPrimitive)
 CYInfix_(true, 8, "instanceof", InstanceOf)
 CYInfix_(true, 8, "in", In)
-CYInfix_(false, 9, "==", Equal)
-CYInfix_(false, 9, "!=", NotEqual)
-CYInfix_(false, 9, "===", Identical)
-CYInfix_(false, 9, "!==", NotIdentical)
-CYInfix_(false, 10, "&", BitwiseAnd)
-CYInfix_(false, 11, "^", BitwiseXOr)
-CYInfix_(false, 12, "|", BitwiseOr)
+CYInfix_(false, 9, "==", Equal, CYPrimitive)
+CYInfix_(false, 9, "!=", NotEqual, CYPrimitive)
+CYInfix_(false, 9, "===", Identical, CYPrimitive)
+CYInfix_(false, 9, "!==", NotIdentical, CYPrimitive)
+CYInfix_(false, 10, "&", BitwiseAnd, CYPrimitive)
+CYInfix_(false, 11, "^", BitwiseXOr, CYPrimitive)
+CYInfix_(false, 12, "|", BitwiseOr, CYPrimitive)
 CYInfix_(false, 13, "&&", LogicalAnd)
 CYInfix_(false, 14, "||", LogicalOr)
 
@@ -0,0 +1,358 @@
+/* Cycript - The Truly Universal Scripting Language
+ * Copyright (C) 2009-2016  Jay Freeman (saurik)
+*/
+
+/* GNU Affero General Public License, Version 3 {{{ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/* }}} */
+
+#include "Driver.hpp"
+#include "Syntax.hpp"
+#include "Value.hpp"
+
+namespace {
+
+class CYValueParser {
+  private:
+    CYPool &pool_;
+    const char *data_;
+    const char *end_;
+
+    static int Hex(char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool Start(char c) {
+        return c >= 'a' && c <= 'z' || c >= 'A' && c <= 'Z' || c == '_' || c == '$';
+    }
+
+    static bool Part(char c) {
+        return Start(c) || c >= '0' && c <= '9';
+    }
+
+    void Space() {
+        while (data_ != end_ && (*data_ == ' ' || *data_ == '\t' || *data_ == '\n' || *data_ == '\r'))
+            ++data_;
+    }
+
+    bool Next(char c) {
+        Space();
+        if (data_ == end_ || *data_ != c)
+            return false;
+        ++data_;
+        return true;
+    }
+
+    bool Point(std::string &value, size_t digits) {
+        if (size_t(end_ - data_) < digits)
+            return false;
+        unsigned point(0);
+        for (size_t i(0); i != digits; ++i) {
+            int digit(Hex(*data_++));
+            if (digit == -1)
+                return false;
+            point = point << 4 | digit;
+        }
+
+        // matches what the scanner does with \x and \u, including lone surrogates
+        if (point < 0x80)
+            value += char(point);
+        else if (point < 0x800) {
+            value += char(0xc0 | point >> 6);
+            value += char(0x80 | point & 0x3f);
+        } else {
+            value += char(0xe0 | point >> 12);
+            value += char(0x80 | point >> 6 & 0x3f);
+            value += char(0x80 | point & 0x3f);
+        }
+
+        return true;
+    }
+
+    CYString *String() {
+        char quote(*data_++);
+        std::string value;
+
+        for (;;) {
+            if (data_ == end_)
+                return NULL;
+            char next(*data_++);
+            if (next == quote)
+                break;
+            if (next == '\r' || next == '\n')
+                return NULL;
+            if (next != '\\') {
+                value += next;
+                continue;
+            }
+
+            if (data_ == end_)
+                return NULL;
+            switch (next = *data_++) {
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'v': value += '\v'; break;
+
+                case 'x':
+                    if (!Point(value, 2))
+                        return NULL;
+                break;
+
+                case 'u':
+                    if (!Point(value, 4))
+                        return NULL;
+                break;
+
+                default:
+                    // octal, \u{}, line continuations and non-ASCII are left to the scanner
+                    if (Part(next) || (next & 0x80) != 0 || next == '\r' || next == '\n')
+                        return NULL;
+                    value += next;
+            }
+        }
+
+        return new(pool_) CYString(pool_.strmemdup(value.data(), value.size()), value.size());
+    }
+
+    CYNumber *Number() {
+        const char *begin(data_);
+        for (char last('\0'); data_ != end_ && (Part(*data_) || *data_ == '.' || (*data_ == '+' || *data_ == '-') && (last == 'e' || last == 'E')); ++data_)
+            last = *data_;
+
+        char text[64];
+        size_t size(data_ - begin);
+        if (size == 0 || size >= sizeof(text))
+            return NULL;
+        memcpy(text, begin, size);
+        text[size] = '\0';
+
+        // strtod would also take words such as inf and nan, which the full grammar reads as identifiers
+        if (!(text[0] >= '0' && text[0] <= '9' || text[0] == '.'))
+            return NULL;
+
+        // mirrors the NumericLiteral rules in Scanner.lpp.in
+        int base(0);
+        const char *digits(text);
+        if (text[0] == '0' && size > 1)
+            switch (text[1]) {
+                case 'x': case 'X': base = 16; digits += 2; break;
+                case 'o': case 'O': base = 8; digits += 2; break;
+                case 'b': case 'B': base = 2; digits += 2; break;
+
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                    base = strspn(text, "01234567") == size ? 8 : 10;
+                    digits += 1;
+                break;
+            }
+
+        char *end;
+        double value;
+        if (base == 0)
+            value = strtod(text, &end);
+        else if (*digits == '\0' || *digits == '+' || *digits == '-')
+            return NULL;
+        else
+            value = strtoull(digits, &end, base);
+
+        if (end != text + size)
+            return NULL;
+        return new(pool_) CYNumber(value);
+    }
+
+    CYWord *Word() {
+        const char *begin(data_);
+        while (data_ != end_ && Part(*data_))
+            ++data_;
+        return new(pool_) CYWord(pool_.strmemdup(begin, data_ - begin));
+    }
+
+    CYArray *Array() {
+        ++data_;
+        CYElement *elements(NULL);
+        CYElement **next(&elements);
+
+        for (;;) {
+            if (Next(']'))
+                break;
+
+            CYExpression *value(NULL);
+            if (!Next(',')) {
+                value = Value();
+                if (value == NULL)
+                    return NULL;
+            }
+
+            CYElementValue *element(new(pool_) CYElementValue(value));
+            *next = element;
+            next = &element->next_;
+
+            if (value == NULL)
+                continue;
+            if (Next(']'))
+                break;
+            if (!Next(','))
+                return NULL;
+        }
+
+        return new(pool_) CYArray(elements);
+    }
+
+    CYObject *Object() {
+        ++data_;
+        CYProperty *properties(NULL);
+        CYProperty **next(&properties);
+
+        for (;;) {
+            if (Next('}'))
+                break;
+
+            CYPropertyName *name;
+            if (data_ == end_)
+                return NULL;
+            else if (*data_ == '"' || *data_ == '\'')
+                name = String();
+            else if (Start(*data_))
+                name = Word();
+            else
+                name = Number();
+
+            if (name == NULL || !Next(':'))
+                return NULL;
+
+            CYExpression *value(Value());
+            if (value == NULL)
+                return NULL;
+
+            CYPropertyValue *property(new(pool_) CYPropertyValue(name, value));
+            *next = property;
+            next = &property->next_;
+
+            if (Next('}'))
+                break;
+            if (!Next(','))
+                return NULL;
+        }
+
+        return new(pool_) CYObject(properties);
+    }
+
+    // (typedef ...)(value): only the type goes through the full grammar
+    CYExpression *Typed() {
+        const char *begin(data_);
+        for (size_t depth(0); ; ) {
+            if (data_ == end_)
+                return NULL;
+            char next(*data_++);
+            if (next == '"' || next == '\'')
+                return NULL;
+            else if (next == '(')
+                ++depth;
+            else if (next == ')' && --depth == 0)
+                break;
+        }
+
+        CYDriver driver(pool_, CYUTF8String(begin, data_ - begin));
+        if (driver.Parse(CYMarkExpression) || !driver.errors_.empty() || driver.context_ == NULL)
+            return NULL;
+
+        if (!Next('('))
+            return NULL;
+        CYExpression *value(Value());
+        if (value == NULL || !Next(')'))
+            return NULL;
+
+        return new(pool_) CYCall(driver.context_, new(pool_) CYArgument(value));
+    }
+
+  public:
+    CYValueParser(CYPool &pool, CYUTF8String data) :
+        pool_(pool),
+        data_(data.data),
+        end_(data.data + data.size)
+    {
+    }
+
+    CYExpression *Value() {
+        Space();
+        if (data_ == end_)
+            return NULL;
+
+        switch (*data_) {
+            case '[':
+                return Array();
+            case '{':
+                return Object();
+            case '"': case '\'':
+                return String();
+            case '(':
+                return Typed();
+
+            case '&': {
+                ++data_;
+                CYExpression *rhs(Value());
+                return rhs == NULL ? NULL : new(pool_) CYAddressOf(rhs);
+            }
+
+            case '-': {
+                ++data_;
+                Space();
+                CYExpression *rhs(Number());
+                return rhs == NULL ? NULL : new(pool_) CYNegate(rhs);
+            }
+        }
+
+        if (!Start(*data_))
+            return Number();
+
+        CYWord *word(Word());
+        const char *value(word->word_);
+        if (false);
+        else if (strcmp(value, "true") == 0)
+            return new(pool_) CYTrue();
+        else if (strcmp(value, "false") == 0)
+            return new(pool_) CYFalse();
+        else if (strcmp(value, "null") == 0)
+            return new(pool_) CYNull();
+        else if (strcmp(value, "undefined") == 0 || strcmp(value, "NaN") == 0 || strcmp(value, "Infinity") == 0)
+            return new(pool_) CYVariable(new(pool_) CYIdentifier(value));
+        return NULL;
+    }
+
+    bool Done() {
+        Space();
+        return data_ == end_;
+    }
+};
+
+}
+
+_visible CYExpression *CYParseValue(CYPool &pool, CYUTF8String data) {
+    CYValueParser parser(pool, data);
+    CYExpression *value(parser.Value());
+    if (value == NULL || !parser.Done())
+        return NULL;
+    return value;
+}
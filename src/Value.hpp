@@ -0,0 +1,35 @@
+/* Cycript - The Truly Universal Scripting Language
+ * Copyright (C) 2009-2016  Jay Freeman (saurik)
+*/
+
+/* GNU Affero General Public License, Version 3 {{{ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/* }}} */
+
+#ifndef CYCRIPT_VALUE_HPP
+#define CYCRIPT_VALUE_HPP
+
+#include "Pooling.hpp"
+#include "String.hpp"
+
+struct CYExpression;
+
+// parses the CYON the agent sends back (literals, arrays, objects, typed pointers and & refs)
+// without going through the full grammar; returns NULL for anything else, which should then be
+// handed to CYDriver as before
+_visible CYExpression *CYParseValue(CYPool &pool, CYUTF8String data);
+
+#endif/*CYCRIPT_VALUE_HPP*/
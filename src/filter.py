@@ -19,15 +19,16 @@ def include(source, output_file, filters):
             if not handled:
                 match = include_pattern.match(line)
                 if match is not None:
-                    other_source = os.path.join(os.path.dirname(source), match.group(1))
-                    include(other_source, output_file, filters)
+                    if len(condition) == 0 or condition[-1]:
+                        other_source = os.path.join(os.path.dirname(source), match.group(1))
+                        include(other_source, output_file, filters)
                     handled = True
 
             if not handled:
                 match = begin_pattern.match(line)
                 if match is not None:
                     requirements = match.group(1).split(" ")
-                    satisfied = any([req.strip() in filters for req in requirements])
+                    satisfied = any([(req.strip()[1:] not in filters) if req.strip().startswith('!') else (req.strip() in filters) for req in requirements])
                     condition.append(satisfied)
                     handled = True
 
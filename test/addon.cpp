@@ -68,11 +68,12 @@ class Binding {
         return NULL;
     }
 
+    // execute(command[, optimize[, passes]]), with the same optimize and passes as cylang's compile
     static napi_value Execute(napi_env env, napi_callback_info info) {
-        napi_value command_value;
-        size_t argc = 1;
-        napi_get_cb_info(env, info, &argc, &command_value, NULL, NULL);
-        if (argc != 1) {
+        napi_value argv[3];
+        size_t argc = 3;
+        napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+        if (argc < 1) {
             napi_throw_error(env, "EINVAL", "Missing command value");
             return NULL;
         }
@@ -80,18 +81,30 @@ class Binding {
         CYPool pool;
 
         const char *command;
-        if (!GetStringArg(env, pool, command_value, &command))
+        if (!GetStringArg(env, pool, argv[0], &command))
+            return NULL;
+
+        CYOptions options;
+
+        if (argc >= 2) {
+            uint32_t level;
+            if (napi_get_value_uint32(env, argv[1], &level) != napi_ok || level > 1) {
+                napi_throw_type_error(env, "EINVAL", "Expected an optimization level of 0 or 1");
+                return NULL;
+            }
+            options.Level(level);
+        }
+
+        if (argc >= 3 && !GetPassesArg(env, pool, argv[2], options))
             return NULL;
 
         try {
-            std::stringbuf stream(command);
-            CYDriver driver(pool, stream);
+            CYDriver driver(pool, CYUTF8String(command));
             driver.strict_ = false;
 
             if (driver.Parse() || !driver.errors_.empty()) {
                 for (CYDriver::Errors::const_iterator error(driver.errors_.begin()); error != driver.errors_.end(); ++error) {
-                    auto message(error->message_);
-                    napi_throw_error(env, "EINVAL", message.c_str());
+                    napi_throw_error(env, "EINVAL", error->message_);
                     return NULL;
                 }
 
@@ -105,7 +118,6 @@ class Binding {
             }
 
             std::stringbuf str;
-            CYOptions options;
             CYOutput out(str, options);
             out.pretty_ = false;
             driver.Replace(options);
@@ -126,7 +138,65 @@ class Binding {
         }
     }
 
+    // pools(tracking) turns pool accounting on or off and returns the ?pool report
+    static napi_value Pools(napi_env env, napi_callback_info info) {
+        napi_value argv[1];
+        size_t argc = 1;
+        napi_get_cb_info(env, info, &argc, argv, NULL, NULL);
+
+        bool tracking;
+        if (argc < 1 || napi_get_value_bool(env, argv[0], &tracking) != napi_ok) {
+            napi_throw_type_error(env, "EINVAL", "Expected a boolean");
+            return NULL;
+        }
+
+        CYPoolSetTracking(tracking);
+
+        std::ostringstream out;
+        CYPoolReport(out);
+        auto report(out.str());
+
+        napi_value result_value;
+        napi_create_string_utf8(env, report.c_str(), report.size(), &result_value);
+        return result_value;
+    }
+
   private:
+    // each pass is an object key, turned on or off by its value
+    static bool GetPassesArg(napi_env env, CYPool &pool, napi_value value, CYOptions &options) {
+        napi_value names;
+        uint32_t count;
+        if (napi_get_property_names(env, value, &names) != napi_ok || napi_get_array_length(env, names, &count) != napi_ok) {
+            napi_throw_type_error(env, "EINVAL", "Expected an object of passes");
+            return false;
+        }
+
+        for (uint32_t i(0); i != count; ++i) {
+            napi_value name;
+            napi_get_element(env, names, i, &name);
+
+            const char *pass;
+            if (!GetStringArg(env, pool, name, &pass))
+                return false;
+
+            napi_value enable;
+            napi_get_property(env, value, name, &enable);
+
+            bool result;
+            if (napi_get_value_bool(env, enable, &result) != napi_ok) {
+                napi_throw_type_error(env, "EINVAL", "Expected a boolean");
+                return false;
+            }
+
+            if (!options.Enable(pass, result)) {
+                napi_throw_error(env, "EINVAL", "Unknown optimization pass");
+                return false;
+            }
+        }
+
+        return true;
+    }
+
     static bool GetStringArg(napi_env env, CYPool &pool, napi_value value, const char **result) {
         if (!GetOptionalStringArg(env, pool, value, result))
             return false;
@@ -168,6 +238,7 @@ NAPI_MODULE_INIT() {
     napi_property_descriptor desc[] = {
         {"attach", NULL, Binding::Attach, NULL, NULL, NULL, napi_default, NULL},
         {"execute", NULL, Binding::Execute, NULL, NULL, NULL, napi_default, NULL},
+        {"pools", NULL, Binding::Pools, NULL, NULL, NULL, napi_default, NULL},
     };
 
     if (napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc) != napi_ok)
@@ -203,4 +203,21 @@ describe('Types', function () {
       [new NSObject init];
     `).should.match(/#"<NSObject: 0x[0-9a-f]+> \(of doom\)"/);
   });
+
+  it('should support optimization levels and passes', function () {
+    cycript.execute('(function (a) { var b = a + 1; return b * 2; })(2)', 0).should.equal('6');
+    cycript.execute('(function (a) { var b = a + 1; return b * 2; })(2)', 1, { rename: false, fold: false }).should.equal('6');
+    (function () {
+      cycript.execute('1', 1, { unknown: true });
+    }).should.throw(/^Unknown optimization pass/);
+  });
+
+  it('should account for chunks a pool held before it was tracked', function () {
+    cycript.pools(true);
+    cycript.execute('1 + 1').should.equal('2');
+    const report = cycript.pools(false);
+    const driver = report.split('\n').find(line => /^driver\s/.test(line)).trim().split(/\s+/);
+    // the driver's pool was already scanning its source when it was tracked, and is gone now
+    driver[7].should.equal('0');
+  });
 });